@@ -39,6 +39,8 @@
 
 #define MAXNOOFTABLES		  32
 
+#define MAXNOOFTHREADS		  16
+
 
 // Error codes.  See interface document for more detail.
 // Call ErrorMessage(code, line[]) to get the text form in line[].
@@ -153,6 +155,22 @@
 #define RETURN_CHUNK_SIZE	-301
 #define TEXT_CHUNK_SIZE	"Chunk size is less  than 1"
 
+// GenerateDeals(), GenerateAndCalcTables()
+#define RETURN_CONSTRAINT	-401
+#define TEXT_CONSTRAINT "Deal constraints are inconsistent"
+
+// GenerateDeals(), GenerateAndCalcTables()
+#define RETURN_NO_DEALS		-402
+#define TEXT_NO_DEALS "No deal meets the constraints within maxTries"
+
+// Batch functions after SetBatchDeadline()
+#define RETURN_DEADLINE		-501
+#define TEXT_DEADLINE "Deadline passed before all boards were solved"
+
+// Solving functions after SetProgressCallback()
+#define RETURN_CANCELLED	-601
+#define TEXT_CANCELLED "Solve was cancelled by the progress callback"
+
 
 
 struct futureTricks {
@@ -212,6 +230,21 @@ struct ddTableDeals {
   struct ddTableDeal 	deals[MAXNOOFTABLES * DDS_STRAINS];
 };
 
+/* Constraints for the deal generator.  fixed holds the cards that
+   each hand must have, with the same bits as in remainCards.  The
+   ranges are inclusive, so 0 .. 37 HCP and 0 .. 13 cards leave a
+   hand unconstrained.  maxTries is the number of deals tried for
+   each deal returned, with 0 for the default of a million. */
+
+struct dealConstraints {
+  unsigned int		fixed[DDS_HANDS][DDS_SUITS];
+  int			minHCP[DDS_HANDS];
+  int			maxHCP[DDS_HANDS];
+  int			minLength[DDS_HANDS][DDS_SUITS];
+  int			maxLength[DDS_HANDS][DDS_SUITS];
+  int			maxTries;
+};
+
 struct ddTableDealPBN {
   char 			cards[80];
 };
@@ -289,6 +322,11 @@ struct solvedPlay {
   int			tricks[53];
 };
 
+struct playAlternatives {
+  int			number;
+  struct futureTricks	position[52];
+};
+
 struct playTracesBin {
   int			noOfBoards;
   struct playTraceBin	plays[MAXNOOFBOARDS];
@@ -304,6 +342,63 @@ struct solvedPlays {
   struct solvedPlay	solved[MAXNOOFBOARDS];
 };
 
+struct threadStat {
+  int			boards;
+  long long		busyTime;	/* Microseconds */
+  long long		waitTime;	/* Microseconds */
+  int			ttResets;
+  int			ttFullResets;
+  int			ttHarvests;
+  int			dealsBuilt;	/* Deal tables set up */
+  int			dealsShared;	/* Taken from another thread */
+  long long		setupTime;	/* Microseconds */
+};
+
+struct threadStats {
+  int			noOfThreads;
+  struct threadStat	thread[MAXNOOFTHREADS];
+};
+
+struct batchStatus {
+  int			noOfBoards;
+  int			status[MAXNOOFBOARDS];
+  int			lower[MAXNOOFBOARDS];
+  int			upper[MAXNOOFBOARDS];
+};
+
+struct solveProgress {
+  int			thrId;
+  int			nodes;		/* As in futureTricks */
+  int			lowerBound;	/* Of the score being searched */
+  int			upperBound;
+  int			elapsedTime;	/* Milliseconds */
+  double		memoryUsed;	/* kB in the tables of the thread */
+  double		memoryMax;	/* kB */
+};
+
+typedef int (STDCALL * progressCallback)(
+  const struct solveProgress * progp);
+
+#define DDS_BOARD_SOLVED	   0
+#define DDS_BOARD_PARTIAL	   1
+#define DDS_BOARD_SKIPPED	   2
+
+/* Call log written after StartRecording().  The file starts with
+   "DDSR" and DDS_VERSION as an int.  Each record is a type byte,
+   the thread index as a byte and the time in microseconds since
+   StartRecording() as a long long, followed by the inputs of the
+   call as laid out in Recorder.cpp.  Numbers are stored in the
+   byte order of the machine that wrote the log. */
+
+#define DDS_REC_SOLVEBOARD	   1
+#define DDS_REC_SOLVEALL	   2
+#define DDS_REC_CALCDDTABLE	   3
+#define DDS_REC_CALCALLTABLES	   4
+#define DDS_REC_PAR		   5
+#define DDS_REC_ANALYSEPLAY	   6
+#define DDS_REC_ANALYSEALLPLAYS	   7
+#define DDS_REC_ALTERNATIVES	   8
+
 
 
 EXTERN_C DLLEXPORT void STDCALL SetMaxThreads(
@@ -311,6 +406,87 @@ EXTERN_C DLLEXPORT void STDCALL SetMaxThreads(
 
 EXTERN_C DLLEXPORT void STDCALL FreeMemory();
 
+EXTERN_C DLLEXPORT void STDCALL SetThreadIdleTime(
+  int 			seconds);
+
+/* SetColdMemory(megabytes) gives each strain table of each thread
+   a side store of that size, or none with 0, the default.  Blocks
+   that a full table would throw away are packed into it, and a
+   lookup that misses in the table looks there.  This pays off for
+   hard deals that fill the table.  The store is only allocated
+   once a table is full, and a new deal empties it.  SetColdMemory()
+   waits for a thread that is solving to finish its current board
+   before it resizes the stores of that thread. */
+
+EXTERN_C DLLEXPORT void STDCALL SetColdMemory(
+  int 			megabytes);
+
+/* With SetDeterministic(1), the batch functions start each group
+   of boards with the same deal and strain from an empty table, and
+   a thread keeps a group to itself.  The results and node counts of
+   each board then no longer depend on the number of threads or on
+   which thread got which boards, at the cost of the reuse between
+   groups. */
+
+EXTERN_C DLLEXPORT void STDCALL SetDeterministic(
+  int			on);
+
+/* SetBatchDeadline(milliSeconds) gives each later call of
+   SolveAllBoards, SolveAllChunks*, CalcAllTables* and
+   AnalyseAllPlays* that long from its start, or no limit with 0,
+   the default.  While there is a deadline, the boards that are
+   expected to be fastest are solved first.  If a board is not
+   solved in time, the call returns RETURN_DEADLINE, but the boards
+   that were solved have their normal results.  GetBatchStatus()
+   then tells for each board whether it was solved, partly solved
+   or not started.
+
+   A partly solved board has the cards it found so far, maybe none,
+   and lower and upper bound the score of its best card.  With a
+   chunk size above 1 and in DD tables, the scores that are not
+   known are -1, and lower and upper bound the one that was being
+   solved.  Par is only calculated for tables that were solved.
+   For CalcAllTables* the status is per table, without bounds.  A
+   play trace has solved.number set to the cards that were solved,
+   and lower and upper bound the declarer tricks at the next card. */
+
+EXTERN_C DLLEXPORT void STDCALL SetBatchDeadline(
+  int			milliSeconds);
+
+EXTERN_C DLLEXPORT void STDCALL GetBatchStatus(
+  struct batchStatus	* statusp);
+
+/* SetProgressCallback(callback, milliSeconds) has callback called
+   by each search that has run for that long, and again after each
+   further interval, or never with a NULL callback, the default.
+   It is called on the thread that searches, every 256 tricks at
+   the most, so it must return quickly and be safe to call from
+   several threads at once.  The bounds are those proven so far on
+   the score for the side to play, in the search that is running:
+   The optimum, or with solutions 3 the score of the next card.
+   If the callback returns non-zero, the search stops as at a batch
+   deadline, and the call that it belongs to returns
+   RETURN_CANCELLED.  In a batch that is an error for the board, as
+   any other, while the other boards go on.  The callback may be
+   changed or cleared while solving.  A search that was just about
+   to call the old callback can still call it once after that, so
+   it must stay valid until the solving calls that were running
+   when it was cleared have returned. */
+
+EXTERN_C DLLEXPORT void STDCALL SetProgressCallback(
+  progressCallback	callback,
+  int			milliSeconds);
+
+EXTERN_C DLLEXPORT void STDCALL GetThreadStats(
+  struct threadStats	* statsp);
+
+EXTERN_C DLLEXPORT void STDCALL ResetThreadStats();
+
+EXTERN_C DLLEXPORT int STDCALL StartRecording(
+  const char		* fname);
+
+EXTERN_C DLLEXPORT void STDCALL StopRecording();
+
 EXTERN_C DLLEXPORT int STDCALL SolveBoard(
   struct deal 		dl, 
   int 			target, 
@@ -327,6 +503,63 @@ EXTERN_C DLLEXPORT int STDCALL SolveBoardPBN(
   struct futureTricks 	* futp, 
   int 			thrId);
 
+/* As SolveBoard with target -1, but the searches for the optimum
+   are spread over all threads, so that a single hard deal is
+   solved faster.  The library owns all the threads during the
+   call.  Other targets and solutions == 3 just call SolveBoard
+   with thread 0. */
+
+EXTERN_C DLLEXPORT int STDCALL SolveBoardSpeculative(
+  struct deal 		dl,
+  int 			target,
+  int 			solutions,
+  int 			mode,
+  struct futureTricks	* futp);
+
+/* As SolveBoard with target -1, solutions 1 and mode 1, but the
+   search stops after horizon tricks, so that it takes a small part
+   of the time on the first tricks of a hard deal.  The score in
+   futp is an estimate.  The actual score is sure to lie between
+   lower and upper.  horizon == 0 is an exact search, and then both
+   bounds equal the score.  The call is not recorded. */
+
+EXTERN_C DLLEXPORT int STDCALL SolveBoardHorizon(
+  struct deal 		dl,
+  int 			horizon,
+  struct futureTricks	* futp,
+  int 			* lower,
+  int 			* upper,
+  int 			thrId);
+
+/* StartPonder returns at once, and solves the positions after each
+   card that the hand to play in dl may play in the background on
+   thread thrId, best cards first.  Once the card is known, call
+   PonderSolve with the new position.  It stops the background work
+   and gives the result that was found for the position, or else
+   solves it on thread thrId.  Thread thrId must be left alone in
+   the meantime.  StopPonder just stops the background work.
+   Stopping breaks off the search that is running, so it returns
+   at once, but the table of that strain then starts over.  The
+   batch functions, such as SolveAllBoards, CalcDDtable and
+   AnalyseAllPlaysBin, and also SolveBoardSpeculative use all
+   threads, so they call StopPonder first. */
+
+EXTERN_C DLLEXPORT int STDCALL StartPonder(
+  struct deal 		dl,
+  int 			target,
+  int 			solutions,
+  int 			mode,
+  int 			thrId);
+
+EXTERN_C DLLEXPORT int STDCALL PonderSolve(
+  struct deal 		dl,
+  int 			target,
+  int 			solutions,
+  int 			mode,
+  struct futureTricks	* futp);
+
+EXTERN_C DLLEXPORT void STDCALL StopPonder();
+
 EXTERN_C DLLEXPORT int STDCALL CalcDDtable(
   struct ddTableDeal 	tableDeal, 
   struct ddTableResults * tablep);
@@ -349,6 +582,24 @@ EXTERN_C DLLEXPORT int STDCALL CalcAllTablesPBN(
   struct ddTablesRes 	* resp, 
   struct allParResults 	* presp);
 
+/* Generate random deals that meet the constraints, reproducibly
+   from seed.  GenerateAndCalcTables also solves them, as by
+   CalcAllTables without par.  deals may then be NULL. */
+
+EXTERN_C DLLEXPORT int STDCALL GenerateDeals(
+  struct dealConstraints * consp,
+  unsigned long long	seed,
+  int 			noOfDeals,
+  struct ddTableDeal	* deals);
+
+EXTERN_C DLLEXPORT int STDCALL GenerateAndCalcTables(
+  struct dealConstraints * consp,
+  unsigned long long	seed,
+  int 			noOfDeals,
+  int 			trumpFilter[DDS_STRAINS],
+  struct ddTableDeal	* deals,
+  struct ddTableResults * results);
+
 EXTERN_C DLLEXPORT int STDCALL SolveAllBoards(
   struct boardsPBN 	* bop, 
   struct solvedBoards 	* solvedp);
@@ -396,6 +647,19 @@ EXTERN_C DLLEXPORT int STDCALL DealerPar(
   int			dealer,
   int			vulnerable);
 
+/* CalcDealerPar gives the same result as CalcDDtable followed by
+   DealerPar, but it only solves as much of the table as the par
+   calculation needs, mostly with target searches.  It solves on
+   the given thread like SolveBoard, so it takes about as long as
+   the two on one thread, but leaves the other threads free. */
+
+EXTERN_C DLLEXPORT int STDCALL CalcDealerPar(
+  struct ddTableDeal	tableDeal,
+  struct parResultsDealer * presp,
+  int			dealer,
+  int			vulnerable,
+  int			threadIndex);
+
 EXTERN_C DLLEXPORT int STDCALL DealerParBin(
   struct ddTableResults * tablep, 
   struct parResultsMaster * presp,
@@ -426,6 +690,26 @@ EXTERN_C DLLEXPORT int STDCALL AnalysePlayPBN(
   struct solvedPlay	* solvedp,
   int			thrId);
 
+/* All the cards that the hand to play could have played before
+   each card of the trace, with their scores as in SolveBoard with
+   solutions 3.  position[n] is for the position before the card
+   play.suit[n], play.rank[n], and number is the number of cards
+   of the trace, or of the positions before an error.  The positions
+   share one table on the thread, and each one starts from the score
+   of the card played before it. */
+
+EXTERN_C DLLEXPORT int STDCALL AnalysePlayAlternativesBin(
+  struct deal		dl,
+  struct playTraceBin	play,
+  struct playAlternatives * altp,
+  int			thrId);
+
+EXTERN_C DLLEXPORT int STDCALL AnalysePlayAlternativesPBN(
+  struct dealPBN	dlPBN,
+  struct playTracePBN	playPBN,
+  struct playAlternatives * altp,
+  int			thrId);
+
 EXTERN_C DLLEXPORT int STDCALL AnalyseAllPlaysBin(
   struct boards		* bop,
   struct playTracesBin	* plp,
@@ -26,6 +26,15 @@
 #define DDS_DIAG_WIDTH  34
 
 
+long long MicroTime();
+
+bool WatchSearch(
+  localVarType          * thrp);
+
+bool ProgressStop(
+  localVarType          * thrp,
+  long long             now);
+
 void Make3Simple(
   pos                   * posPoint,
   unsigned short int    trickCards[DDS_SUITS],
@@ -145,6 +154,7 @@ void InitFileABstats(int thrId)
   thrp->ABStats.SetName(AB_MAIN_LOOKUP   , "Main lookup");
   thrp->ABStats.SetName(AB_SIDE_LOOKUP   , "Other lookup");
   thrp->ABStats.SetName(AB_MOVE_LOOP     , "Move trial");
+  thrp->ABStats.SetName(AB_HORIZON       , "Horizon");
 #else
   UNUSED(thrId);
 #endif
@@ -185,13 +195,18 @@ void InitFileTTstats(int thrId)
 #ifdef DDS_TT_STATS
   localVarType * thrp = &localVar[thrId];
 
+  // One file for each of the strain tables.
   char fname[DDS_FNAME_LEN];
-  sprintf(fname, "%s%d%s", 
-    DDS_TT_STATS_PREFIX,
-    thrId,
-    DDS_DEBUG_SUFFIX);
+  for (int s = 0; s < DDS_STRAINS; s++)
+  {
+    sprintf(fname, "%s%d_%d%s", 
+      DDS_TT_STATS_PREFIX,
+      thrId,
+      s,
+      DDS_DEBUG_SUFFIX);
 
-  thrp->transTable.SetFile(fname);
+    thrp->strainTables[s].SetFile(fname);
+  }
 #else
   UNUSED(thrId);
 #endif
@@ -389,6 +404,12 @@ bool ABsearch0(
   for (int ss = 0; ss < DDS_SUITS; ss++)
     posPoint->winRanks[depth][ss] = 0;
 
+  // Past the batch deadline or when cancelled, the search unwinds
+  // at once.  The value does not matter, as SolveBoard drops the
+  // search and its table.
+  if (thrp->watched && WatchSearch(thrp))
+    return false;
+
   if (depth >= 20)
   {
     /* Find node that fits the suit lengths */
@@ -401,7 +422,7 @@ bool ABsearch0(
     bool lowerFlag;
     TIMER_START(TIMER_LOOKUP + depth);
     nodeCardsType * cardsP =
-      thrp->transTable.Lookup(
+      thrp->transTable->Lookup(
         tricks, hand, posPoint->aggr, posPoint->handDist, 
         limit, &lowerFlag);
     TIMER_END(TIMER_LOOKUP + depth);
@@ -528,7 +549,7 @@ if (depth == 4)
     bool lowerFlag;
     TIMER_START(TIMER_LOOKUP + depth);
     nodeCardsType * cardsP =
-      thrp->transTable.Lookup(
+      thrp->transTable->Lookup(
         tricks, hand, posPoint->aggr, posPoint->handDist, 
         limit, &lowerFlag);
     TIMER_END(TIMER_LOOKUP + depth);
@@ -558,6 +579,32 @@ if (depth == 4)
     }
   }
 
+  if (depth <= thrp->horizonDepth)
+  {
+    // SolveBoardHorizon stops the search here.  The side on lead
+    // has its quick tricks for sure and at most all the rest.
+    int rest = tricks + 1;
+    int lead;
+    bool maxLeads = (thrp->nodeTypeStore[hand] == MAXNODE);
+
+    if (thrp->horizonMode == DDS_HORIZON_LOWER)
+      lead = (maxLeads ? qtricks : rest);
+    else if (thrp->horizonMode == DDS_HORIZON_UPPER)
+      lead = (maxLeads ? rest : qtricks);
+    else
+      lead = (qtricks + rest) / 2;
+
+    bool value = (posPoint->tricksMAX + 
+      (maxLeads ? lead : rest - lead) >= target);
+
+    // The estimate may depend on any card.
+    for (int ss = 0; ss < DDS_SUITS; ss++)
+      posPoint->winRanks[depth][ss] = posPoint->aggr[ss];
+
+    AB_COUNT(AB_HORIZON, value, depth);
+    return value;
+  }
+
   bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
   bool value   = ! success;
 
@@ -662,7 +709,7 @@ ABexit:
      ? true : false;
 
   TIMER_START(TIMER_BUILD + depth);
-  thrp->transTable.Add(
+  thrp->transTable->Add(
     tricks,
     hand,
     posPoint->aggr,
@@ -940,6 +987,31 @@ ABexit:
 }
 
 
+bool WatchSearch(
+  localVarType          * thrp)
+{
+  // The clock is only read every 256 tricks.
+  if (thrp->expired || (thrp->trickNodes & 0xff) != 0)
+    return thrp->expired;
+
+  if (thrp->stopFlag != nullptr && thrp->stopFlag->load())
+  {
+    thrp->cancelled = true;
+    thrp->expired   = true;
+    return true;
+  }
+
+  long long now = MicroTime();
+  if (thrp->deadline > 0 && now > thrp->deadline)
+    thrp->expired = true;
+  else if (thrp->nextReport > 0 && now >= thrp->nextReport &&
+      ProgressStop(thrp, now))
+    thrp->expired = true;
+
+  return thrp->expired;
+}
+
+
 void Make0(
   pos                   * posPoint, 
   int                   depth, 
@@ -34,12 +34,13 @@
 #define AB_MAIN_LOOKUP          4
 #define AB_SIDE_LOOKUP          5
 #define AB_MOVE_LOOP            6
+#define AB_HORIZON              7
 
 
 
 #define DDS_MAXDEPTH    49
 #define DDS_LINE_LEN    20
-#define DDS_AB_POS       7
+#define DDS_AB_POS       8
 
 
 
@@ -13,6 +13,24 @@
 #include "dds.h"
 #include "SolveBoard.h"
 #include "PBN.h"
+#include "Recorder.h"
+
+
+bool TableSolved(
+  ddTableResults        * tablep);
+
+
+bool TableSolved(
+  ddTableResults        * tablep)
+{
+  // After a batch deadline the scores that are not known are -1.
+  for (int s = 0; s < DDS_STRAINS; s++)
+    for (int h = 0; h < DDS_HANDS; h++)
+      if (tablep->resTable[s][h] < 0)
+        return false;
+
+  return true;
+}
 
 
 int STDCALL CalcDDtable(
@@ -23,6 +41,10 @@ int STDCALL CalcDDtable(
   boards bo;
   solvedBoards solved;
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordCalcDDtable(&tableDeal);
+
   for (int h = 0; h < DDS_HANDS; h++)
     for (int s = 0; s < DDS_SUITS; s++)
       dl.remainCards[h][s] = tableDeal.cards[h][s];
@@ -101,6 +123,10 @@ int STDCALL CalcAllTables(
   if (count * dealsp->noOfTables > MAXNOOFTABLES * DDS_STRAINS)
     return RETURN_TOO_MANY_TABLES;
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordCalcAllTables(dealsp, mode, trumpFilter);
+
   int ind = 0;
   int lastIndex = 0;
   resp->noOfBoards = 0;
@@ -135,10 +161,14 @@ int STDCALL CalcAllTables(
 
   bo.noOfBoards = lastIndex + 1;
 
+  StartBatchDeadline();
   int res = SolveAllBoardsN(&bo, &solved, 4, 1);
-  if (res != 1) 
+  if (res != 1 && res != RETURN_DEADLINE) 
     return res;
 
+  // The status is per table, not per strain.
+  BatchGroup(count);
+
   resp->noOfBoards += 4 * solved.noOfBoards;
 
   for (int m = 0; m < dealsp->noOfTables; m++)
@@ -152,8 +182,9 @@ int STDCALL CalcAllTables(
 
       for (int first = 0; first < DDS_HANDS; first++)
       {
+        int score = solved.solvedBoard[index].score[first];
         resp->results[m].resTable[strain][ rho[first] ] =
-          13 - solved.solvedBoard[index].score[first];
+          (score < 0 ? -1 : 13 - score);
       }
     }
   }
@@ -163,13 +194,16 @@ int STDCALL CalcAllTables(
     /* Calculate par */
     for (int k = 0; k < dealsp->noOfTables; k++) 
     {
-      res = Par(&(resp->results[k]), &(presp->presults[k]), mode);
+      if (! TableSolved(&resp->results[k]))
+        continue;
+
+      int ret = Par(&(resp->results[k]), &(presp->presults[k]), mode);
       /* vulnerable 0: None  1: Both  2: NS  3: EW */
-      if (res != 1)
-        return res;
+      if (ret != 1)
+        return ret;
     }
   }
-  return RETURN_NO_FAULT;
+  return res;
 }
  
 
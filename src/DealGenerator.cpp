@@ -0,0 +1,294 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#include "dds.h"
+
+/*
+   Deal number k of a run is always drawn from its own random
+   stream, seeded from the user's seed and k.  So the deals only
+   depend on the seed, and not on the number of threads or on
+   how the work is split up.
+
+   The cards that are not fixed are shuffled and dealt out to
+   fill up the hands one hand at a time.  Each hand is tested
+   against its constraints with bit operations on the holdings
+   as soon as it is complete, so most tries stop after the first
+   constrained hand.  The first deal in the stream that passes
+   is kept.
+*/
+
+#define GEN_DEFAULT_TRIES       1000000
+
+#define GEN_ALL_CARDS           0x7ffc
+
+
+struct genSetupType
+{
+  unsigned              fixed[DDS_HANDS][DDS_SUITS];
+  int                   freeCards[52];
+  int                   noOfFree;
+  int                   room[DDS_HANDS];
+  int                   maxTries;
+};
+
+
+int GenSetup(
+  dealConstraints       * consp,
+  genSetupType          * gsp);
+
+int GenDeal(
+  dealConstraints       * consp,
+  genSetupType          * gsp,
+  unsigned long long    seed,
+  int                   dealNo,
+  ddTableDeal           * dealp);
+
+bool GenCheckHand(
+  dealConstraints       * consp,
+  int                   hand,
+  unsigned              cards[DDS_SUITS]);
+
+unsigned long long GenMix(
+  unsigned long long    x);
+
+
+int STDCALL GenerateDeals(
+  dealConstraints       * consp,
+  unsigned long long    seed,
+  int                   noOfDeals,
+  ddTableDeal           * deals)
+{
+  genSetupType gs;
+  int res = GenSetup(consp, &gs);
+  if (res != RETURN_NO_FAULT)
+    return res;
+
+  int fail = RETURN_NO_FAULT;
+
+#if defined (_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  if (omp_get_dynamic())
+    omp_set_dynamic(0);
+  omp_set_num_threads(noOfThreads > 0 ? noOfThreads : 1);
+#endif
+
+  #pragma omp parallel for schedule(dynamic, 4)
+  for (int k = 0; k < noOfDeals; k++)
+  {
+    int r = GenDeal(consp, &gs, seed, k, &deals[k]);
+    if (r != RETURN_NO_FAULT)
+      fail = r;
+  }
+
+  return fail;
+}
+
+
+int STDCALL GenerateAndCalcTables(
+  dealConstraints       * consp,
+  unsigned long long    seed,
+  int                   noOfDeals,
+  int                   trumpFilter[DDS_STRAINS],
+  ddTableDeal           * deals,
+  ddTableResults        * results)
+{
+  // The deals of each batch are generated straight into the
+  // input of CalcAllTables.  Deal k is the same deal that
+  // GenerateDeals() would return with the same seed.
+
+  genSetupType gs;
+  int res = GenSetup(consp, &gs);
+  if (res != RETURN_NO_FAULT)
+    return res;
+
+  ddTableDeals * dlsp = static_cast<ddTableDeals *>
+    (malloc(sizeof(ddTableDeals)));
+  ddTablesRes * resp = static_cast<ddTablesRes *>
+    (malloc(sizeof(ddTablesRes)));
+  if (dlsp == nullptr || resp == nullptr)
+  {
+    free(dlsp);
+    free(resp);
+    return RETURN_UNKNOWN_FAULT;
+  }
+
+#if defined (_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  if (omp_get_dynamic())
+    omp_set_dynamic(0);
+#endif
+
+  for (int start = 0; start < noOfDeals; start += MAXNOOFTABLES)
+  {
+    int number = Min(MAXNOOFTABLES, noOfDeals - start);
+    int fail = RETURN_NO_FAULT;
+
+#if defined (_OPENMP) && !defined(DDS_THREADS_SINGLE)
+    omp_set_num_threads(noOfThreads > 0 ? noOfThreads : 1);
+#endif
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int m = 0; m < number; m++)
+    {
+      int r = GenDeal(consp, &gs, seed, start + m, &dlsp->deals[m]);
+      if (r != RETURN_NO_FAULT)
+        fail = r;
+    }
+
+    if (fail != RETURN_NO_FAULT)
+    {
+      res = fail;
+      break;
+    }
+
+    dlsp->noOfTables = number;
+    res = CalcAllTables(dlsp, -1, trumpFilter, resp, nullptr);
+    if (res != RETURN_NO_FAULT)
+      break;
+
+    for (int m = 0; m < number; m++)
+    {
+      if (deals)
+        deals[start + m] = dlsp->deals[m];
+      results[start + m] = resp->results[m];
+    }
+  }
+
+  free(dlsp);
+  free(resp);
+  return res;
+}
+
+
+int GenSetup(
+  dealConstraints       * consp,
+  genSetupType          * gsp)
+{
+  unsigned seen[DDS_SUITS] = {0, 0, 0, 0};
+
+  for (int h = 0; h < DDS_HANDS; h++)
+  {
+    if (consp->minHCP[h] > consp->maxHCP[h])
+      return RETURN_CONSTRAINT;
+
+    int count = 0;
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      unsigned f = consp->fixed[h][s];
+      if ((f & ~static_cast<unsigned>(GEN_ALL_CARDS)) || (f & seen[s]))
+        return RETURN_CONSTRAINT;
+      if (consp->minLength[h][s] > consp->maxLength[h][s])
+        return RETURN_CONSTRAINT;
+
+      seen[s] |= f;
+      gsp->fixed[h][s] = f;
+      count += counttable[f >> 2];
+    }
+
+    if (count > 13)
+      return RETURN_CONSTRAINT;
+    gsp->room[h] = 13 - count;
+  }
+
+  gsp->noOfFree = 0;
+  for (int s = 0; s < DDS_SUITS; s++)
+    for (int r = 2; r <= 14; r++)
+      if ((seen[s] & (1u << r)) == 0)
+        gsp->freeCards[gsp->noOfFree++] = (s << 4) | r;
+
+  gsp->maxTries = (consp->maxTries > 0 ?
+    consp->maxTries : GEN_DEFAULT_TRIES);
+
+  return RETURN_NO_FAULT;
+}
+
+
+int GenDeal(
+  dealConstraints       * consp,
+  genSetupType          * gsp,
+  unsigned long long    seed,
+  int                   dealNo,
+  ddTableDeal           * dealp)
+{
+  unsigned long long state = GenMix(seed ^ GenMix(
+    static_cast<unsigned long long>(dealNo) + 1));
+
+  int cards[52];
+  int n = gsp->noOfFree;
+
+  // A Fisher-Yates shuffle is uniform from any starting order,
+  // so the cards are not reset between tries.
+  for (int i = 0; i < n; i++)
+    cards[i] = gsp->freeCards[i];
+
+  for (int t = 0; t < gsp->maxTries; t++)
+  {
+    int i = 0, h;
+    for (h = 0; h < DDS_HANDS; h++)
+    {
+      unsigned * holding = dealp->cards[h];
+      for (int s = 0; s < DDS_SUITS; s++)
+        holding[s] = gsp->fixed[h][s];
+
+      // The random number is scaled into the range rather than
+      // taken modulo.
+      for (int k = 0; k < gsp->room[h]; k++, i++)
+      {
+        state += 0x9e3779b97f4a7c15ULL;
+        unsigned long long r = GenMix(state) >> 32;
+        int j = i + static_cast<int>
+          ((r * static_cast<unsigned long long>(n - i)) >> 32);
+        int c = cards[j];
+        cards[j] = cards[i];
+        cards[i] = c;
+        holding[c >> 4] |= 1u << (c & 0xf);
+      }
+
+      if (! GenCheckHand(consp, h, holding))
+        break;
+    }
+
+    if (h == DDS_HANDS)
+      return RETURN_NO_FAULT;
+  }
+
+  return RETURN_NO_DEALS;
+}
+
+
+bool GenCheckHand(
+  dealConstraints       * consp,
+  int                   hand,
+  unsigned              cards[DDS_SUITS])
+{
+  int hcp = 0;
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    unsigned c = cards[s];
+    int len = counttable[c >> 2];
+    if (len < consp->minLength[hand][s] || 
+        len > consp->maxLength[hand][s])
+      return false;
+
+    hcp += static_cast<int>(
+      4 * ((c >> 14) & 1) + 3 * ((c >> 13) & 1) +
+      2 * ((c >> 12) & 1) + ((c >> 11) & 1));
+  }
+
+  return (hcp >= consp->minHCP[hand] && hcp <= consp->maxHCP[hand]);
+}
+
+
+unsigned long long GenMix(
+  unsigned long long    x)
+{
+  // The splitmix64 finalizer.
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
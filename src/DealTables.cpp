@@ -0,0 +1,308 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#include <chrono>
+#include <thread>
+
+#include "DealTables.h"
+
+
+long long SetupTime();
+
+
+DealTables::DealTables()
+{
+  for (int n = 0; n < MAXNOOFTHREADS; n++)
+    list[n] = nullptr;
+
+  DealTables::ResetCounts();
+
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_init_lock(&lock);
+#endif
+}
+
+
+long long SetupTime()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void DealTables::Build(
+  dealTablesType        * dtp)
+{
+  /* Initialization of the rel structure is inspired by
+     a solution given by Thomas Andrews */
+
+  unsigned int          topBitRank = 1;
+  unsigned int          topBitNo   = 2;
+
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    for (int ord = 1; ord <= 13; ord++)
+    {
+      dtp->rel[0].absRank[ord][s].hand = -1;
+      dtp->rel[0].absRank[ord][s].rank = 0;
+    }
+  }
+
+  // handLookup[suit][absolute rank] is the hand (N = 0 etc.)
+  // holding the absolute rank in suit.
+
+  int handLookup[DDS_SUITS][15];
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    for (int r = 14; r >= 2; r--)
+    {
+      handLookup[s][r] = 0;
+      for (int h = 0; h < DDS_HANDS; h++)
+      {
+        if (dtp->suit[h][s] & bitMapRank[r])
+        {
+          handLookup[s][r] = h;
+          break;
+        }
+      }
+    }
+  }
+
+  TransTable::MakeAggr(handLookup, dtp->aggr);
+
+  relRanksType * relp;
+  for (unsigned int aggr = 1; aggr < 8192; aggr++)
+  {
+    if (aggr >= (topBitRank << 1))
+    {
+      /* Next top bit */
+      topBitRank <<= 1;
+      topBitNo++;
+    }
+
+    dtp->rel[aggr] = dtp->rel[aggr ^ topBitRank];
+    relp = &dtp->rel[aggr];
+
+    int weight = counttable[aggr];
+    for (int c = weight; c >= 2; c--)
+    {
+      for (int s = 0; s < DDS_SUITS; s++)
+      {
+        relp->absRank[c][s].hand = relp->absRank[c-1][s].hand;
+        relp->absRank[c][s].rank = relp->absRank[c-1][s].rank;
+      }
+    }
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      relp->absRank[1][s].hand =
+        static_cast<char>(handLookup[s][topBitNo]);
+      relp->absRank[1][s].rank = static_cast<char>(topBitNo);
+    }
+  }
+}
+
+
+dealTablesType * DealTables::Acquire(
+  unsigned short int    suit[][DDS_SUITS],
+  int                   thrId)
+{
+  // Returns the tables for the cards in suit, or nullptr if there
+  // is no memory for them.  The caller must Release() them again.
+
+  long long start = SetupTime();
+  dealTablesType * dtp = nullptr;
+
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_set_lock(&lock);
+
+  int unused = -1,
+      empty  = -1;
+
+  for (int n = 0; n < MAXNOOFTHREADS; n++)
+  {
+    dealTablesType * lp = list[n];
+    if (lp == nullptr)
+    {
+      if (empty == -1)
+        empty = n;
+    }
+    else if (memcmp(lp->suit, suit, sizeof(lp->suit)) == 0)
+    {
+      dtp = lp;
+      break;
+    }
+    else if (lp->users == 0 && unused == -1)
+      unused = n;
+  }
+
+  if (dtp != nullptr)
+  {
+    dtp->users++;
+    counts[thrId].shared++;
+    omp_unset_lock(&lock);
+
+    // Another thread may still be building them.
+    while (1)
+    {
+      omp_set_lock(&lock);
+      bool ready = dtp->ready;
+      omp_unset_lock(&lock);
+
+      if (ready)
+        break;
+
+      std::this_thread::yield();
+    }
+
+    counts[thrId].setupTime += SetupTime() - start;
+    return dtp;
+  }
+
+  if (unused != -1)
+    dtp = list[unused];
+  else if (empty != -1)
+  {
+    dtp = static_cast<dealTablesType *>(malloc(sizeof(dealTablesType)));
+    list[empty] = dtp;
+  }
+
+  if (dtp == nullptr)
+  {
+    omp_unset_lock(&lock);
+    return nullptr;
+  }
+
+  memcpy(dtp->suit, suit, sizeof(dtp->suit));
+  dtp->users = 1;
+  dtp->ready = false;
+  omp_unset_lock(&lock);
+
+  DealTables::Build(dtp);
+
+  omp_set_lock(&lock);
+  dtp->ready = true;
+  omp_unset_lock(&lock);
+
+#else
+  // Without a lock, each thread keeps its own tables in its slot.
+  dtp = list[thrId];
+  if (dtp == nullptr)
+  {
+    dtp = static_cast<dealTablesType *>(malloc(sizeof(dealTablesType)));
+    if (dtp == nullptr)
+      return nullptr;
+
+    dtp->ready = false;
+    list[thrId] = dtp;
+  }
+
+  dtp->users = 1;
+  if (dtp->ready && memcmp(dtp->suit, suit, sizeof(dtp->suit)) == 0)
+  {
+    counts[thrId].shared++;
+    counts[thrId].setupTime += SetupTime() - start;
+    return dtp;
+  }
+
+  memcpy(dtp->suit, suit, sizeof(dtp->suit));
+  DealTables::Build(dtp);
+  dtp->ready = true;
+#endif
+
+  counts[thrId].built++;
+  counts[thrId].setupTime += SetupTime() - start;
+  return dtp;
+}
+
+
+void DealTables::Share(
+  dealTablesType        * dtp)
+{
+  // For a thread that takes over the deal of another thread.
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_set_lock(&lock);
+  dtp->users++;
+  omp_unset_lock(&lock);
+#else
+  dtp->users++;
+#endif
+}
+
+
+void DealTables::Release(
+  dealTablesType        * dtp)
+{
+  if (dtp == nullptr)
+    return;
+
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_set_lock(&lock);
+  dtp->users--;
+  omp_unset_lock(&lock);
+#else
+  dtp->users--;
+#endif
+}
+
+
+void DealTables::FreeUnused()
+{
+  // May run while other threads are solving.  They only take a copy
+  // under the lock, so a copy that has no users under the lock can
+  // be freed.  Without the lock, a thread sets up its slot while
+  // others may be looking, so the copies are left to FreeAll().
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  DealTables::FreeAll();
+#endif
+}
+
+
+void DealTables::FreeAll()
+{
+  // Frees the copies that have no users.  Without the lock, this is
+  // only safe when no thread is solving.
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_set_lock(&lock);
+#endif
+
+  for (int n = 0; n < MAXNOOFTHREADS; n++)
+  {
+    if (list[n] != nullptr && list[n]->users == 0)
+    {
+      free(list[n]);
+      list[n] = nullptr;
+    }
+  }
+
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  omp_unset_lock(&lock);
+#endif
+}
+
+
+void DealTables::ResetCounts()
+{
+  for (int t = 0; t < MAXNOOFTHREADS; t++)
+  {
+    counts[t].built     = 0;
+    counts[t].shared    = 0;
+    counts[t].setupTime = 0;
+  }
+}
+
+
+void DealTables::GetCounts(
+  int                   thrId,
+  threadStat            * tsp)
+{
+  tsp->dealsBuilt  = counts[thrId].built;
+  tsp->dealsShared = counts[thrId].shared;
+  tsp->setupTime   = counts[thrId].setupTime;
+}
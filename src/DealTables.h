@@ -0,0 +1,101 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#ifndef DDS_DEALTABLESH
+#define DDS_DEALTABLESH
+
+#include "dds.h"
+#include "../include/dll.h"
+
+/*
+   The tables that only depend on the cards, rel and aggr, take
+   1.6 MB per deal.  CalcDDtable and CalcAllTables spread the five
+   strains of a deal over up to five threads, and each of them used
+   to build the same tables.  Now the first thread on a deal builds
+   them, and the other threads on the same cards use that copy.
+   A copy is counted by its users.  A copy without users is kept,
+   as the next thread may well want the same cards, and otherwise
+   it is reused for another deal.
+
+   Each thread holds at most one copy, so there are never more
+   than MAXNOOFTHREADS of them.  Without OpenMP there is no lock,
+   and each thread keeps a copy of its own.
+*/
+
+struct dealTablesType
+{
+  unsigned short int    suit[DDS_HANDS][DDS_SUITS];
+  int                   users;
+  bool                  ready;
+
+  // rel[aggr].absRank[absolute rank][suit].hand is the hand
+  // (N = 0, E = 1 etc.) which holds the absolute rank in
+  // the suit characterized by aggr.
+  // rel[aggr].absRank[absolute rank][suit].rank is the
+  // relative rank of that card.
+  relRanksType          rel[8192]; // 960 KB
+
+  TransTable::aggrType  aggr[8192]; // 640 KB
+};
+
+
+class DealTables
+{
+  private:
+
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+    omp_lock_t          lock;
+#endif
+
+    dealTablesType      * list[MAXNOOFTHREADS];
+
+    struct countType
+    {
+      int               built,
+                        shared;
+      long long         setupTime; // Microseconds
+    };
+
+    countType           counts[MAXNOOFTHREADS];
+
+    void Build(
+      dealTablesType    * dtp);
+
+  public:
+
+    DealTables();
+
+    // There is no destructor.  The library destructor may run after
+    // the static ones, and its FreeMemory() still takes the lock.
+    // So the lock is never destroyed, and FreeMemory() frees the
+    // tables.
+
+    dealTablesType * Acquire(
+      unsigned short int suit[][DDS_SUITS],
+      int               thrId);
+
+    void Share(
+      dealTablesType    * dtp);
+
+    void Release(
+      dealTablesType    * dtp);
+
+    void FreeUnused();
+
+    void FreeAll();
+
+    void ResetCounts();
+
+    void GetCounts(
+      int               thrId,
+      threadStat        * tsp);
+};
+
+#endif
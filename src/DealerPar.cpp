@@ -10,6 +10,7 @@
 
 
 #include "dds.h"
+#include "SolveBoard.h"
 
 
 /* First index: 0 nonvul, 1 vul.  Second index: tricks down */
@@ -108,8 +109,69 @@ struct list_type
 #define BIGNUM 9999
 
 
+/* The par calculation reads the DD table through par_makes()
+   and the functions after it.  DealerPar() has the whole table.
+   CalcDealerPar() starts out knowing nothing but that each entry
+   is between 0 and 13.  It narrows an entry down with a target
+   search ("can North make 10 tricks in spades?") when it is asked
+   a question that the bounds do not answer, and only does a full
+   search when it needs the exact number of tricks.  The searches
+   of a denomination share the transposition table, so the par
+   functions below ask about one denomination at a time where
+   they can. */
+
+struct par_table_type
+{
+  ddTableResults        * tablep;
+  deal                  dl;
+  int                   lo[DDS_STRAINS][DDS_HANDS];
+  int                   hi[DDS_STRAINS][DDS_HANDS];
+  int                   thrId;
+  int                   res;
+};
+
+
+int dealer_par(
+  par_table_type        * ptp,
+  parResultsDealer      * presp,
+  int                   dealer,
+  int                   vulnerable);
+
+int par_tricks(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   hand);
+
+bool par_makes(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   hand,
+  int                   tricks);
+
+int side_first(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side);
+
+int side_max(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side);
+
+int side_upper(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side);
+
+bool side_makes(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side,
+  int                   tricks);
+
+
 void survey_scores(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   dealer,
   int                   vul_by_side[2],
   data_type             * data,
@@ -117,7 +179,7 @@ void survey_scores(
   list_type             list[2][5]);
 
 void best_sacrifice(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   no,
   int                   dno,
@@ -127,7 +189,7 @@ void best_sacrifice(
   int                   * best_down);
 
 void sacrifices_as_text(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   dealer,
   int                   best_down,
@@ -138,13 +200,19 @@ void sacrifices_as_text(
   char                  results[10][10],
   int                   * res_no);
 
+void resolve_sacrifice(
+  par_table_type        * ptp,
+  int                   side,
+  int                   dno,
+  list_type             * slist);
+
 void reduce_contract(
   int                   * no,
   int                   down,
   int                   * plus);
 
 void contract_as_text(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   no,
   int                   dno,
@@ -164,6 +232,56 @@ int STDCALL DealerPar(
   parResultsDealer      * presp,
   int                   dealer,
   int                   vulnerable)
+{
+  par_table_type pt;
+  pt.tablep = tablep;
+  pt.res    = RETURN_NO_FAULT;
+
+  return dealer_par(&pt, presp, dealer, vulnerable);
+}
+
+
+int STDCALL CalcDealerPar(
+  ddTableDeal           tableDeal,
+  parResultsDealer      * presp,
+  int                   dealer,
+  int                   vulnerable,
+  int                   thrId)
+{
+  par_table_type pt;
+  pt.tablep = nullptr;
+  pt.thrId  = thrId;
+  pt.res    = RETURN_NO_FAULT;
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      pt.dl.remainCards[h][s] = tableDeal.cards[h][s];
+
+  for (int k = 0; k <= 2; k++)
+  {
+    pt.dl.currentTrickRank[k] = 0;
+    pt.dl.currentTrickSuit[k] = 0;
+  }
+
+  for (int s = 0; s < DDS_STRAINS; s++)
+  {
+    for (int h = 0; h < DDS_HANDS; h++)
+    {
+      pt.lo[s][h] = 0;
+      pt.hi[s][h] = 13;
+    }
+  }
+
+  int res = dealer_par(&pt, presp, dealer, vulnerable);
+  return (pt.res != RETURN_NO_FAULT ? pt.res : res);
+}
+
+
+int dealer_par(
+  par_table_type        * ptp,
+  parResultsDealer      * presp,
+  int                   dealer,
+  int                   vulnerable)
 {
   /* dealer     0: North 1: East  2: South  3: West */
   /* vulnerable 0: None  1: Both  2: NS     3: EW   */
@@ -178,7 +296,7 @@ int STDCALL DealerPar(
 
 
   int num_cand;
-  survey_scores(tablep, dealer, vul_by_side, &data, &num_cand, list);
+  survey_scores(ptp, dealer, vul_by_side, &data, &num_cand, list);
   int side = data.primacy;
 
   if (side == -1)
@@ -206,7 +324,7 @@ int STDCALL DealerPar(
     int dno = lists[n].dno;
     int target = DOWN_TARGET[no][vul_no];
 
-    best_sacrifice(tablep, side, no, dno, dealer, list, sacr, &down);
+    best_sacrifice(ptp, side, no, dno, dealer, list, sacr, &down);
 
     if (down <= target)
     {
@@ -249,7 +367,7 @@ int STDCALL DealerPar(
       int no = lists[n].no, plus;
       reduce_contract(&no, sac_gap[n], &plus);
 
-      contract_as_text(tablep, side, no, lists[n].dno, 
+      contract_as_text(ptp, side, no, lists[n].dno, 
         plus, presp->contracts[res_no]);
       res_no++;
     }
@@ -264,7 +382,7 @@ int STDCALL DealerPar(
     for (int n = 0; n < num_cand; n++)
     {
       if (type[n] != 0 || lists[n].down != best_down) continue;
-      sacrifices_as_text(tablep, side, dealer, best_down,
+      sacrifices_as_text(ptp, side, dealer, best_down,
         lists[n].no, lists[n].dno, list, sacr, 
         presp->contracts, &res_no);
     }
@@ -275,7 +393,7 @@ int STDCALL DealerPar(
 
 
 void survey_scores(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   dealer,
   int                   vul_by_side[2],
   data_type             * data,
@@ -305,52 +423,57 @@ void survey_scores(
 
   for (int side = 0; side <= 1; side++)
   {
-    int highest_making_no = 0;
-    int dearest_making_no = 0;
-    int dearest_score     = 0;
+    stats[side].highest_making_no = 0;
+    stats[side].dearest_making_no = 0;
+    stats[side].dearest_score     = 0;
+  }
+
+  for (int dno = 0; dno <= 4; dno++)
+  {
+    int strain = DENOM_ORDER[dno];
 
-    for (int dno = 0; dno <= 4; dno++)
+    for (int side = 0; side <= 1; side++)
     {
       list_type * slist = &list[side][dno];
-      int * t = tablep->resTable[ DENOM_ORDER[dno] ];
-      int a    = t[side];
-      int b    = t[side+2];
-      int best = (a > b ? a : b);
+      data_type * sside = &stats[side];
 
-      int no        = 5*(best-7) + dno + 1;
-      slist->no     = no; /* May be negative! */
-
-      if (best < 7)
+      if (! side_makes(ptp, strain, side, 7))
       {
-        slist->score = 0;
+        /* The contract number is negative, and it is only needed
+           for sacrifices.  best_sacrifice() looks it up if so.
+           tricks == -1 means that it is not known yet. */
+        slist->no     = dno - 4;
+        slist->score  = 0;
+        slist->tricks = -1;
         continue;
       }
 
+      int best      = side_max(ptp, strain, side);
+      int no        = 5*(best-7) + dno + 1;
+      slist->no     = no;
+
       int score     = SCORES[no][ vul_by_side[side] ];
       slist->score  = score;
       slist->dno    = dno;
       slist->tricks = best;
 
-      if (score > dearest_score)
+      if (score > sside->dearest_score)
       {
-        dearest_score     = score;
-        dearest_making_no = no;
+        sside->dearest_score     = score;
+        sside->dearest_making_no = no;
       }
-      else if (score == dearest_score && no < dearest_making_no)
+      else if (score == sside->dearest_score &&
+          no < sside->dearest_making_no)
       {
         /* The lowest such, e.g. 3NT and 5C. */
-        dearest_making_no = no;
+        sside->dearest_making_no = no;
       }
 
-      if (no > highest_making_no)
+      if (no > sside->highest_making_no)
       {
-        highest_making_no = no;
+        sside->highest_making_no = no;
       }
     }
-    data_type * sside = &stats[side];
-    sside->highest_making_no = highest_making_no;
-    sside->dearest_making_no = dearest_making_no;
-    sside->dearest_score     = dearest_score;
   }
 
   int primacy = 0;
@@ -374,11 +497,11 @@ void survey_scores(
     /* Special case, depends who can bid it first. */
     int dno   = (s0-1) % 5;
     int t_max = list[0][dno].tricks;
-    int * t   = tablep->resTable[ DENOM_ORDER[dno] ];
 
+    /* No player takes more than t_max tricks. */
     for (int pno = dealer; pno <= dealer+3; pno++)
     {
-      if (t[pno % 4] != t_max) continue;
+      if (! par_makes(ptp, DENOM_ORDER[dno], pno % 4, t_max)) continue;
       primacy = pno % 2;
       break;
     }
@@ -426,7 +549,7 @@ void survey_scores(
 
 
 void best_sacrifice(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   no,
   int                   dno,
@@ -439,45 +562,75 @@ void best_sacrifice(
   list_type * sacr_list = list[other];
   *best_down = BIGNUM;
 
-  for (int eno = 0; eno <= 4; eno++)
-  {
-    list_type sacr = sacr_list[eno];
-    int down = BIGNUM;
+  /* The sacrifices in denominations where the other side's
+     number of tricks is not known yet come last.  If even the
+     most tricks it could take costs more than a sacrifice that
+     was already found, the number is not needed.  The value
+     stored is then too low, but it is still above the best one,
+     which is all that sacrifices_as_text() looks at. */
 
-    if (eno == dno)
+  for (int pass = 0; pass <= 1; pass++)
+  {
+    for (int eno = 0; eno <= 4; eno++)
     {
-      int t_max     = static_cast<int>((no+34) / 5);
-      int * t       = tablep->resTable[ DENOM_ORDER[dno] ];
-      int incr_flag = 0;
-      for (int pno = dealer; pno <= dealer+3; pno++)
+      list_type * sacr = &sacr_list[eno];
+      bool later = (eno != dno && sacr->tricks < 0);
+      if (later != (pass == 1)) continue;
+
+      int down = BIGNUM;
+
+      if (eno == dno)
       {
-        int diff = t_max - t[pno % 4];
-        int s    = pno % 2;
-        if (s == side)
+        int strain    = DENOM_ORDER[dno];
+        int t_max     = static_cast<int>((no+34) / 5);
+        int incr_flag = 0;
+        for (int pno = dealer; pno <= dealer+3; pno++)
         {
-          if (diff == 0) incr_flag = 1;
+          int hand = pno % 4;
+          int s    = pno % 2;
+          if (s == side)
+          {
+            if (par_makes(ptp, strain, hand, t_max) &&
+                ! par_makes(ptp, strain, hand, t_max+1))
+              incr_flag = 1;
+          }
+          else
+          {
+            int local = t_max - par_tricks(ptp, strain, hand) +
+              incr_flag;
+            if (local < down) down = local;
+          }
         }
-        else
+        resolve_sacrifice(ptp, other, dno, sacr);
+        if (sacr->no + 5*down > 35) down = BIGNUM;
+      }
+      else
+      {
+        if (later)
         {
-          int local = diff + incr_flag;
-          if (local < down) down = local;
+          int hi    = side_upper(ptp, DENOM_ORDER[eno], other);
+          int no_hi = 5*(hi-7) + eno + 1;
+          int low   = static_cast<int>((no - no_hi + 4) / 5);
+          if (low > *best_down)
+          {
+            sacr_table[dno][eno] = low;
+            continue;
+          }
+          resolve_sacrifice(ptp, other, eno, sacr);
         }
+
+        down = static_cast<int>((no - sacr->no + 4) / 5);
+        if (sacr->no + 5*down > 35) down = BIGNUM;
       }
-      if (sacr.no + 5*down > 35) down = BIGNUM;
-    }
-    else
-    {
-      down = static_cast<int>((no - sacr.no + 4) / 5);
-      if (sacr.no + 5*down > 35) down = BIGNUM;
+      sacr_table[dno][eno] = down;
+      if (down < *best_down) *best_down = down;
     }
-    sacr_table[dno][eno] = down;
-    if (down < *best_down) *best_down = down;
   }
 }
  
 
 void sacrifices_as_text(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   dealer,
   int                   best_down,
@@ -499,29 +652,30 @@ void sacrifices_as_text(
     if (eno != dno)
     {
       int no_sac = sacr_list[eno].no + 5 * best_down;
-      contract_as_text(tablep, other, no_sac, eno, -best_down, 
+      contract_as_text(ptp, other, no_sac, eno, -best_down, 
         results[*res_no]);
       (*res_no)++;
       continue;
     }
 
+    int strain    = DENOM_ORDER[dno];
     int t_max     = static_cast<int>((no_decl + 34) / 5);
-    int * t       = tablep->resTable[ DENOM_ORDER[dno] ];
     int incr_flag = 0;
     int p_hit     = 0;
     int  pno_list[2], sac_list[2];
     for (int pno = dealer; pno <= dealer+3; pno++)
     {
       int pno_mod = pno % 4;
-      int diff    = t_max - t[pno_mod];
       int s       = pno % 2;
       if (s == side)
       {
-        if (diff == 0) incr_flag = 1;
+        if (par_makes(ptp, strain, pno_mod, t_max) &&
+            ! par_makes(ptp, strain, pno_mod, t_max+1))
+          incr_flag = 1;
       }
       else
       {
-        down = diff + incr_flag;
+        down = t_max - par_tricks(ptp, strain, pno_mod) + incr_flag;
         if (down != best_down) continue;
         pno_list[p_hit] = pno_mod;
         sac_list[p_hit] = no_decl + 5*incr_flag;
@@ -542,7 +696,7 @@ void sacrifices_as_text(
     if (ns0 == ns1)
     {
       /* Both players */
-      contract_as_text(tablep, other, ns0, eno, -best_down, 
+      contract_as_text(ptp, other, ns0, eno, -best_down, 
         results[*res_no]);
       (*res_no)++;
       continue;
@@ -556,6 +710,22 @@ void sacrifices_as_text(
 }
 
 
+void resolve_sacrifice(
+  par_table_type        * ptp,
+  int                   side,
+  int                   dno,
+  list_type             * slist)
+{
+  /* Fills in the contract number of a side that takes at most
+     6 tricks, see survey_scores(). */
+  if (slist->tricks >= 0) return;
+
+  int best      = side_max(ptp, DENOM_ORDER[dno], side);
+  slist->no     = 5*(best-7) + dno + 1;
+  slist->tricks = best;
+}
+
+
 void reduce_contract(
   int                   * no,
   int                   sac_gap,
@@ -589,17 +759,17 @@ void reduce_contract(
 
 
 void contract_as_text(
-  ddTableResults        * tablep,
+  par_table_type        * ptp,
   int                   side,
   int                   no,
   int                   dno,
   int                   delta,
   char                  str[10])
 {
-  int * t   = tablep->resTable[ DENOM_ORDER[dno] ];
-  int ta    = t[side];
-  int tb    = t[side+2];
-  int t_max = (ta > tb ? ta : tb);
+  int strain = DENOM_ORDER[dno];
+  int t_max  = side_max(ptp, strain, side);
+  bool ma    = par_makes(ptp, strain, side,   t_max);
+  bool mb    = par_makes(ptp, strain, side+2, t_max);
 
   char d[4]  = "";
   if (delta != 0) 
@@ -608,8 +778,8 @@ void contract_as_text(
   sprintf(str, "%s%s%s%s%s",
     NUMBER_TO_CONTRACT[no],
     (delta < 0 ? "*-" : "-"),
-    (ta == t_max ? NUMBER_TO_PLAYER[side]   : ""),
-    (tb == t_max ? NUMBER_TO_PLAYER[side+2] : ""),
+    (ma ? NUMBER_TO_PLAYER[side]   : ""),
+    (mb ? NUMBER_TO_PLAYER[side+2] : ""),
     d);
 }
 
@@ -625,3 +795,166 @@ void sacrifice_as_text(
     NUMBER_TO_PLAYER[pno],
     down);
 }
+
+
+int par_tricks(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   hand)
+{
+  if (ptp->tablep)
+    return ptp->tablep->resTable[strain][hand];
+
+  int * lo = &ptp->lo[strain][hand];
+  int * hi = &ptp->hi[strain][hand];
+
+  if (*hi == *lo + 1)
+    par_makes(ptp, strain, hand, *hi);
+
+  if (*lo == *hi)
+    return *lo;
+
+  /* The side on lead is the defence. */
+  futureTricks fut;
+  ptp->dl.trump = strain;
+  ptp->dl.first = (hand + 1) % 4;
+
+  int res = SolveBoard(ptp->dl, -1, 1, 1, &fut, ptp->thrId);
+  if (res != RETURN_NO_FAULT)
+  {
+    ptp->res = res;
+    return 0;
+  }
+
+  *lo = 13 - fut.score[0];
+  *hi = *lo;
+  return *lo;
+}
+
+
+bool par_makes(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   hand,
+  int                   tricks)
+{
+  if (ptp->tablep)
+    return (ptp->tablep->resTable[strain][hand] >= tricks);
+
+  int * lo = &ptp->lo[strain][hand];
+  int * hi = &ptp->hi[strain][hand];
+
+  if (*lo >= tricks)
+    return true;
+  if (*hi < tricks)
+    return false;
+
+  /* Declarer makes unless the defence takes 14 - tricks. */
+  futureTricks fut;
+  ptp->dl.trump = strain;
+  ptp->dl.first = (hand + 1) % 4;
+
+  int target = 14 - tricks;
+  int res = SolveBoard(ptp->dl, target, 1, 1, &fut, ptp->thrId);
+  if (res != RETURN_NO_FAULT)
+  {
+    ptp->res = res;
+    return false;
+  }
+
+  if (fut.score[0] == target)
+  {
+    *hi = tricks - 1;
+    return false;
+  }
+
+  *lo = tricks;
+  return true;
+}
+
+
+int side_first(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side)
+{
+  /* The hand of the side that is likely to take more tricks,
+     which is the one to search first:  Longer trumps, or more
+     high-card points in notrump. */
+  int hand[2] = { side, side+2 };
+  int value[2];
+
+  for (int k = 0; k <= 1; k++)
+  {
+    if (ptp->hi[strain][ hand[k] ] < ptp->lo[strain][ hand[1-k] ])
+      return hand[1-k];
+
+    unsigned * h = ptp->dl.remainCards[ hand[k] ];
+    if (strain != DDS_NOTRUMP)
+      value[k] = counttable[ h[strain] >> 2 ];
+    else
+    {
+      value[k] = 0;
+      for (int s = 0; s < DDS_SUITS; s++)
+        value[k] += static_cast<int>(
+          4 * ((h[s] >> 14) & 1) + 3 * ((h[s] >> 13) & 1) +
+          2 * ((h[s] >> 12) & 1) + ((h[s] >> 11) & 1));
+    }
+  }
+  return (value[1] > value[0] ? hand[1] : hand[0]);
+}
+
+
+int side_max(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side)
+{
+  if (ptp->tablep)
+  {
+    int * t = ptp->tablep->resTable[strain];
+    return (t[side] > t[side+2] ? t[side] : t[side+2]);
+  }
+
+  /* One exact search, and usually a single target search to
+     show that partner does not take more. */
+  int first  = side_first(ptp, strain, side);
+  int second = (first + 2) % 4;
+
+  int t = par_tricks(ptp, strain, first);
+  if (! par_makes(ptp, strain, second, t+1))
+    return t;
+
+  return par_tricks(ptp, strain, second);
+}
+
+
+int side_upper(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side)
+{
+  if (ptp->tablep)
+    return side_max(ptp, strain, side);
+
+  int a = ptp->hi[strain][side];
+  int b = ptp->hi[strain][side+2];
+  return (a > b ? a : b);
+}
+
+
+bool side_makes(
+  par_table_type        * ptp,
+  int                   strain,
+  int                   side,
+  int                   tricks)
+{
+  if (ptp->tablep)
+    return (side_max(ptp, strain, side) >= tricks);
+
+  int first  = side_first(ptp, strain, side);
+  int second = (first + 2) % 4;
+
+  return (par_makes(ptp, strain, first, tricks) ||
+          par_makes(ptp, strain, second, tricks));
+}
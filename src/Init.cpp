@@ -8,12 +8,17 @@
 */
 
 
+#include <atomic>
+#include <thread>
+
 #include "dds.h"
 #include "threadmem.h"
 #include "Init.h"
 #include "Stats.h"
 #include "ABsearch.h"
 #include "Scheduler.h"
+#include "DealTables.h"
+#include "SuitTricks.h"
 
 void InitConstants();
 
@@ -25,7 +30,14 @@ void FreeThreadMem();
 
 localVarType localVar[MAXNOOFTHREADS];
 Scheduler scheduler;
+DealTables dealTables;
 int noOfThreads;
+int maxIdleTime = 0;
+int coldMemory = THREADMEM_COLD_MB;
+
+// The number of ThreadBusy scopes on each thread, or -1 while
+// ReleaseIdleThreads() takes its memory.
+std::atomic<int> threadUsers[MAXNOOFTHREADS];
 
 int lho[DDS_HANDS]     = { 1, 2, 3, 0 };
 int rho[DDS_HANDS]     = { 3, 0, 1, 2 };
@@ -187,24 +199,21 @@ void STDCALL SetMaxThreads(
 
   for (int k = 0; k < noOfThreads; k++)
   {
-    localVar[k].transTable.SetMemoryDefault(mem_def);
-    localVar[k].transTable.SetMemoryMaximum(mem_max);
+    // The strain tables share the memory of the thread.
+    for (int s = 0; s < DDS_STRAINS; s++)
+    {
+      localVar[k].strainTables[s].SetMemoryDefault(mem_def);
+      localVar[k].strainTables[s].SetMemoryMaximum(mem_max);
+      localVar[k].strainTables[s].SetMemoryCold(coldMemory);
+    }
+    localVar[k].memDefault = 1024. * mem_def;
+    localVar[k].memMax = 1024. * mem_max;
   }
 
-  if (noOfThreads == oldNoOfThreads)
-  {
-    // Must already have TT allocated.
-  }
-  else if (noOfThreads > oldNoOfThreads)
-  {
-    for (int k = oldNoOfThreads; k < noOfThreads; k++)
-      localVar[k].transTable.MakeTT();
-  }
-  else
-  {
-    for (int k = noOfThreads; k < oldNoOfThreads; k++)
-      localVar[k].transTable.ReturnAllMemory();
-  }
+  // New threads get their memory when they are first used,
+  // see ActivateThread().
+  for (int k = noOfThreads; k < oldNoOfThreads; k++)
+    ReleaseThread(&localVar[k]);
 
   if (! _initialized)
   {
@@ -375,6 +384,9 @@ void InitConstants()
         topside[topBitNo] & botside[ groupData[ris].rank[g-1] ];
     }
   }
+
+  // The single-suit trick table used by QuickTricks.
+  InitSuitTricks();
 }
 
 
@@ -463,81 +475,33 @@ void SetDeal(
 }
 
 
-void SetDealTables(
-  localVarType          * thrp)
+bool SetDealTables(
+  localVarType          * thrp,
+  int                   thrId)
 {
-  unsigned int          topBitRank = 1;
-  unsigned int          topBitNo   = 2;
+  // The old tables are given back first, so that there is always
+  // room for those of the new deal.
 
-  /* Initialization of the rel structure is inspired by
-     a solution given by Thomas Andrews */
+  dealTables.Release(thrp->tables);
+  thrp->tables = dealTables.Acquire(thrp->suit, thrId);
 
-  // rel[aggr].absRank[absolute rank][suit].hand is the hand
-  // (N = 0, E = 1 etc.) which holds the absolute rank in
-  // the suit characterized by aggr.
-  // rel[aggr].absRank[absolute rank][suit].rank is the
-  // relative rank of that card.
-
-  for (int s = 0; s < DDS_SUITS; s++)
+  if (thrp->tables == nullptr)
   {
-    for (int ord = 1; ord <= 13; ord++)
-    {
-      thrp->rel[0].absRank[ord][s].hand = -1;
-      thrp->rel[0].absRank[ord][s].rank = 0;
-    }
-  }
-
-  // handLookup[suit][absolute rank] is the hand (N = 0 etc.)
-  // holding the absolute rank in suit.
+    // Make sure that the next call tries again.
+    for (int h = 0; h < DDS_HANDS; h++)
+      for (int s = 0; s < DDS_SUITS; s++)
+        thrp->suit[h][s] = 0;
 
-  int handLookup[DDS_SUITS][15];
-  for (int s = 0; s < DDS_SUITS; s++)
-  {
-    for (int r = 14; r >= 2; r--)
-    {
-      handLookup[s][r] = 0;
-      for (int h = 0; h < DDS_HANDS; h++)
-      {
-        if (thrp->suit[h][s] & bitMapRank[r])
-        {
-          handLookup[s][r] = h;
-          break;
-        }
-      }
-    }
+    thrp->rel = nullptr;
+    for (int s = 0; s < DDS_STRAINS; s++)
+      thrp->strainTables[s].SetAggr(nullptr);
+    return false;
   }
 
-  thrp->transTable.Init(handLookup);
-
-  relRanksType * relp;
-  for (unsigned int aggr = 1; aggr < 8192; aggr++)
-  {
-    if (aggr >= (topBitRank << 1))
-    {
-      /* Next top bit */
-      topBitRank <<= 1;
-      topBitNo++;
-    }
-
-    thrp->rel[aggr] = thrp->rel[aggr ^ topBitRank];
-    relp = &thrp->rel[aggr];
-
-    int weight = counttable[aggr];
-    for (int c = weight; c >= 2; c--)
-    {
-      for (int s = 0; s < DDS_SUITS; s++)
-      {
-        relp->absRank[c][s].hand = relp->absRank[c-1][s].hand;
-        relp->absRank[c][s].rank = relp->absRank[c-1][s].rank;
-      }
-    }
-    for (int s = 0; s < DDS_SUITS; s++)
-    {
-      relp->absRank[1][s].hand = 
-        static_cast<char>(handLookup[s][topBitNo]);
-      relp->absRank[1][s].rank = static_cast<char>(topBitNo);
-    }
-  }
+  thrp->rel = thrp->tables->rel;
+  for (int s = 0; s < DDS_STRAINS; s++)
+    thrp->strainTables[s].SetAggr(thrp->tables->aggr);
+  return true;
 }
 
 
@@ -585,8 +549,7 @@ void ResetBestMoves(
     thrp->bestMoveTT[d].rank = 0;
   }
 
-  thrp->memUsed = thrp->transTable.MemoryInUse() +
-    ThreadMemoryUsed();
+  thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
 
 #ifdef DDS_AB_STATS
   thrp->ABStats.Reset();
@@ -671,24 +634,398 @@ void FreeThreadMem()
 {
   for (int k = 0; k < noOfThreads; k++)
   {
-    localVar[k].transTable.ResetMemory();
-    localVar[k].memUsed = localVar[k].transTable.MemoryInUse() +
-      ThreadMemoryUsed();
+    if (! localVar[k].active)
+      continue;
+
+    // Only the table in use is kept, as after a new deal.
+    localVarType * thrp = &localVar[k];
+    ForgetStrainTables(thrp);
+    for (int s = 0; s < DDS_STRAINS; s++)
+    {
+      if (&thrp->strainTables[s] == thrp->transTable)
+        thrp->transTable->ResetMemory();
+      else
+        thrp->strainTables[s].ReturnAllMemory();
+    }
+
+    thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
   }
 }
 
 
 void STDCALL FreeMemory()
 {
+  for (int k = 0; k < noOfThreads; k++)
+    ReleaseThread(&localVar[k]);
+
+  dealTables.FreeAll();
+}
+
+
+void STDCALL SetThreadIdleTime(
+  int                   seconds)
+{
+  maxIdleTime = Max(seconds, 0);
+}
+
+
+void STDCALL SetColdMemory(
+  int                   megabytes)
+{
+  coldMemory = Max(megabytes, 0);
+
+  // The tables only allocate the memory once they need it.  As in
+  // ReleaseIdleThreads(), a thread is taken over before its stores
+  // are given back, but here a busy thread is waited for.
   for (int k = 0; k < noOfThreads; k++)
   {
-    localVar[k].transTable.ReturnAllMemory();
-    localVar[k].memUsed = localVar[k].transTable.MemoryInUse() +
-      ThreadMemoryUsed();
+    int users = 0;
+    while (! threadUsers[k].compare_exchange_weak(users, -1))
+    {
+      std::this_thread::yield();
+      users = 0;
+    }
+
+    for (int s = 0; s < DDS_STRAINS; s++)
+      localVar[k].strainTables[s].SetMemoryCold(coldMemory);
+    threadUsers[k] = 0;
   }
 }
 
 
+void STDCALL SetDeterministic(
+  int                   on)
+{
+  scheduler.SetDeterministic(on != 0);
+}
+
+
+void STDCALL GetThreadStats(
+  threadStats           * statsp)
+{
+  statsp->noOfThreads = noOfThreads;
+
+  for (int k = 0; k < MAXNOOFTHREADS; k++)
+  {
+    threadStat * tsp = &statsp->thread[k];
+    scheduler.GetThreadStats(k, tsp);
+    dealTables.GetCounts(k, tsp);
+
+    tsp->ttResets     = 0;
+    tsp->ttFullResets = 0;
+    tsp->ttHarvests   = 0;
+
+    for (int s = 0; s < DDS_STRAINS; s++)
+    {
+      int resets, fullResets, harvests;
+      localVar[k].strainTables[s].GetPageCounts(
+        &resets, &fullResets, &harvests);
+
+      tsp->ttResets     += resets;
+      tsp->ttFullResets += fullResets;
+      tsp->ttHarvests   += harvests;
+    }
+  }
+}
+
+
+void STDCALL ResetThreadStats()
+{
+  scheduler.ResetThreadStats();
+  dealTables.ResetCounts();
+
+  for (int k = 0; k < MAXNOOFTHREADS; k++)
+    for (int s = 0; s < DDS_STRAINS; s++)
+      localVar[k].strainTables[s].ResetPageCounts();
+}
+
+
+bool ActivateThread(
+  localVarType          * thrp)
+{
+  // A thread only takes up memory once it solves something.
+  // The TT pages themselves are allocated on demand anyway.
+
+  thrp->lastUsed = time(nullptr);
+
+  if (thrp->active)
+    return true;
+
+  // The table itself is set up by SelectStrainTable().
+  if (thrp->transTable == nullptr)
+    thrp->transTable = &thrp->strainTables[0];
+  ForgetStrainTables(thrp);
+
+  // Make sure that the next deal is treated as a new one.
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      thrp->suit[h][s] = 0;
+
+  thrp->active = true;
+  return true;
+}
+
+
+void ReleaseThread(
+  localVarType          * thrp)
+{
+  for (int s = 0; s < DDS_STRAINS; s++)
+  {
+    thrp->strainTables[s].ReturnAllMemory();
+    thrp->strainTables[s].SetAggr(nullptr);
+  }
+  ForgetStrainTables(thrp);
+
+  dealTables.Release(thrp->tables);
+  thrp->tables = nullptr;
+  thrp->rel    = nullptr;
+  thrp->active = false;
+  thrp->memUsed = 0.;
+}
+
+
+ThreadBusy::ThreadBusy(
+  localVarType          * thrp)
+{
+  // Waits while the memory of the thread is being released.
+  thrId = static_cast<int>(thrp - localVar);
+  int users = threadUsers[thrId].load();
+  while (users < 0 || 
+      ! threadUsers[thrId].compare_exchange_weak(users, users + 1))
+  {
+    if (users < 0)
+    {
+      std::this_thread::yield();
+      users = threadUsers[thrId].load();
+    }
+  }
+}
+
+
+ThreadBusy::~ThreadBusy()
+{
+  localVar[thrId].lastUsed = time(nullptr);
+  threadUsers[thrId]--;
+}
+
+
+void ReleaseIdleThreads()
+{
+  // Called at the start of each SolveBoard and of the batch
+  // functions.  A thread that is in a ThreadBusy scope is left
+  // alone, and one that is being released cannot enter one.
+  if (maxIdleTime == 0)
+    return;
+
+  time_t now = time(nullptr);
+  bool released = false;
+  for (int k = 0; k < noOfThreads; k++)
+  {
+    int users = 0;
+    if (! threadUsers[k].compare_exchange_strong(users, -1))
+      continue;
+
+    if (localVar[k].active &&
+        difftime(now, localVar[k].lastUsed) >= maxIdleTime)
+    {
+      ReleaseThread(&localVar[k]);
+      released = true;
+    }
+    threadUsers[k] = 0;
+  }
+
+  if (released)
+    dealTables.FreeUnused();
+}
+
+
+void ForgetDeal(
+  int                   thrId)
+{
+  // Makes the next SolveBoard on the thread start as if the thread
+  // were new:  The table is reset, and nothing is left over from
+  // the earlier searches to guide the move ordering.
+
+  localVarType * thrp = &localVar[thrId];
+  if (! thrp->active)
+    return;
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      thrp->suit[h][s] = 0;
+
+  thrp->nodes = 0;
+  ResetBestMoves(thrp);
+}
+
+
+void ForgetStrainTables(
+  localVarType          * thrp)
+{
+  // The memory is kept, but the entries no longer count.
+  for (int s = 0; s < DDS_STRAINS; s++)
+    thrp->tableUsed[s] = 0;
+}
+
+
+void DiscardStrainTable(
+  localVarType          * thrp)
+{
+  // The table in use holds entries that a later search must not
+  // find, also not one with mode == 2.
+  thrp->transTable->ResetMemory();
+}
+
+
+void SelectStrainTable(
+  localVarType          * thrp,
+  int                   strain,
+  bool                  reset)
+{
+  // Makes the table for strain the one in use.  If there is none,
+  // the table in use is taken if it holds nothing, and otherwise
+  // the one that was used the longest time ago.  That table starts
+  // out empty, and so does the table for strain if reset is set.
+
+  int current = static_cast<int>(thrp->transTable - thrp->strainTables);
+  int found   = -1;
+  int oldest  = 0;
+
+  for (int s = 0; s < DDS_STRAINS; s++)
+  {
+    if (thrp->tableUsed[s] > 0 && thrp->tableStrain[s] == strain)
+      found = s;
+    if (thrp->tableUsed[s] < thrp->tableUsed[oldest])
+      oldest = s;
+  }
+
+  if (found == -1)
+  {
+    found = (thrp->tableUsed[current] == 0 ? current : oldest);
+    thrp->tableStrain[found] = strain;
+    reset = true;
+  }
+
+  TransTable * ttp = &thrp->strainTables[found];
+  thrp->transTable = ttp;
+  thrp->tableUsed[found] = ++thrp->tableClock;
+
+  if (! reset)
+    return;
+
+  // The other tables make room for this one before it is built,
+  // so that the search does not start out above the maximum.
+  TrimStrainTables(thrp, thrp->memDefault);
+
+  // A table without memory has been dropped or never used.
+  if (ttp->MemoryInUse() == 0.)
+    ttp->MakeTT();
+  else
+    ttp->ResetMemory();
+}
+
+
+void TrimStrainTables(
+  localVarType          * thrp,
+  double                reserve)
+{
+  // The tables together stay within the memory of the thread.
+  // Tables that hold nothing are dropped first, and then the one
+  // that was used the longest time ago.  The table in use stays,
+  // and it counts as at least reserve KB.
+
+  while (1)
+  {
+    double used = 0.;
+    int victim = -1;
+
+    for (int s = 0; s < DDS_STRAINS; s++)
+    {
+      TransTable * ttp = &thrp->strainTables[s];
+      double mem = ttp->MemoryInUse();
+      if (ttp == thrp->transTable && mem < reserve)
+        mem = reserve;
+      if (mem == 0.)
+        continue;
+
+      used += mem;
+      if (ttp != thrp->transTable &&
+          (victim == -1 || thrp->tableUsed[s] < thrp->tableUsed[victim]))
+        victim = s;
+    }
+
+    if (used <= thrp->memMax || victim == -1)
+      return;
+
+    thrp->strainTables[victim].ReturnAllMemory();
+    thrp->tableUsed[victim] = 0;
+  }
+}
+
+
+double TablesMemoryUsed(
+  localVarType          * thrp)
+{
+  double memUsed = 0.;
+  for (int s = 0; s < DDS_STRAINS; s++)
+    memUsed += thrp->strainTables[s].MemoryInUse();
+  return memUsed;
+}
+
+
+bool CloneThread(
+  int                   fromId,
+  int                   toId)
+{
+  // Gives thread toId the deal and the transposition table of
+  // thread fromId, so that its next SolveBoard on the same cards
+  // goes on where fromId left off.  Neither thread may be solving
+  // while this runs.
+
+  localVarType * srcp = &localVar[fromId];
+  localVarType * thrp = &localVar[toId];
+  ThreadBusy busy(thrp);
+
+  if (srcp->tables == nullptr || ! ActivateThread(thrp))
+    return false;
+
+  // Only the table in use is copied.  The other tables of toId
+  // are for its own earlier deal.
+  ForgetStrainTables(thrp);
+
+  if (! thrp->transTable->CloneFrom(srcp->transTable))
+  {
+    // Start from scratch on the next deal.
+    for (int h = 0; h < DDS_HANDS; h++)
+      for (int s = 0; s < DDS_SUITS; s++)
+        thrp->suit[h][s] = 0;
+    return false;
+  }
+
+  // The deal tables are shared rather than copied.
+  dealTables.Share(srcp->tables);
+  dealTables.Release(thrp->tables);
+  thrp->tables = srcp->tables;
+  thrp->rel    = srcp->rel;
+  for (int s = 0; s < DDS_STRAINS; s++)
+    thrp->strainTables[s].SetAggr(srcp->tables->aggr);
+
+  int n = static_cast<int>(thrp->transTable - thrp->strainTables);
+  thrp->tableStrain[n] = srcp->trump;
+  thrp->tableUsed[n]   = ++thrp->tableClock;
+
+  memcpy(thrp->suit, srcp->suit, sizeof(thrp->suit));
+  thrp->trump = srcp->trump;
+  thrp->nodes = srcp->nodes;
+
+  // The position itself is set up again from the cards.
+  thrp->analysisFlag = true;
+
+  thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
+  return true;
+}
+
+
 double ConstantMemoryUsed()
 {
   double memUsed =
@@ -698,14 +1035,18 @@ double ConstantMemoryUsed()
            + 14 * sizeof(unsigned short int))
            / static_cast<double>(1024.);
 
+  memUsed += SuitTricksMemoryUsed();
+
   return memUsed;
 }
 
 
 double ThreadMemoryUsed()
 {
+  // The deal tables are shared, so this is the most a thread
+  // can add.
   double memUsed =
-    8192 * sizeof(relRanksType)
+    sizeof(dealTablesType)
     / static_cast<double>(1024.);
 
   return memUsed;
@@ -768,6 +1109,14 @@ void STDCALL ErrorMessage(int code, char line[80])
       strcpy(line, TEXT_TOO_MANY_TABLES); break;
     case RETURN_CHUNK_SIZE:
       strcpy(line, TEXT_CHUNK_SIZE); break;
+    case RETURN_CONSTRAINT:
+      strcpy(line, TEXT_CONSTRAINT); break;
+    case RETURN_NO_DEALS:
+      strcpy(line, TEXT_NO_DEALS); break;
+    case RETURN_DEADLINE:
+      strcpy(line, TEXT_DEADLINE); break;
+    case RETURN_CANCELLED:
+      strcpy(line, TEXT_CANCELLED); break;
     default:
       strcpy(line, "Not a DDS error code"); break;
   }
@@ -11,8 +11,9 @@
 void SetDeal(
   struct localVarType   * thrp);
 
-void SetDealTables(
-  struct localVarType   * thrp);
+bool SetDealTables(
+  struct localVarType   * thrp,
+  int                   thrId);
 
 void InitWinners(
   deal                  * dl,
@@ -24,6 +25,55 @@ void ResetBestMoves(
 
 double ThreadMemoryUsed();
 
+bool ActivateThread(
+  struct localVarType   * thrp);
+
+void ReleaseThread(
+  struct localVarType   * thrp);
+
+void ReleaseIdleThreads();
+
+// Keeps ReleaseIdleThreads() away from the memory of a thread
+// while the thread solves.
+class ThreadBusy
+{
+  private:
+
+    int                 thrId;
+
+  public:
+
+    explicit ThreadBusy(
+      struct localVarType * thrp);
+
+    ~ThreadBusy();
+};
+
+void ForgetStrainTables(
+  struct localVarType   * thrp);
+
+void DiscardStrainTable(
+  struct localVarType   * thrp);
+
+void SelectStrainTable(
+  struct localVarType   * thrp,
+  int                   strain,
+  bool                  reset);
+
+void TrimStrainTables(
+  struct localVarType   * thrp,
+  double                reserve);
+
+double TablesMemoryUsed(
+  struct localVarType   * thrp);
+
+void ForgetDeal(
+  int                   thrId);
+
+bool CloneThread(
+  int                   fromId,
+  int                   toId);
+
 void CloseDebugFiles();
 
 // Used by SH for stand-alone mode.
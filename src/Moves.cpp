@@ -135,8 +135,9 @@ void Moves::Init(
   currTrick = tricks;
   trump     = ourTrump;
 
-  if (relStartHand == 0)
-    track[tricks].leadHand = ourLeadHand;
+  // Also when the trick has begun, as the track may be left
+  // over from another deal.
+  track[tricks].leadHand = ourLeadHand;
 
   for (int m = 0; m < 13; m++)
   {
@@ -11,6 +11,7 @@
 #include <stdexcept>
 
 #include "dds.h"
+#include "Recorder.h"
 
 struct par_suits_type {
   int suit;
@@ -57,6 +58,10 @@ int STDCALL Par(ddTableResults * tablep, parResults *presp,
   int res, i, k, m;
   parResultsDealer sidesRes[2];
   parContr2Type parContr2[10];
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordPar(tablep, vulnerable);
   
   int CalcMultiContracts(int max_lower, int tricks);
 
@@ -256,6 +261,9 @@ int STDCALL Par(ddTableResults * tablep, parResults *presp,
 
         /* The Par function computes the par result and contracts. */
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordPar(tablep, vulnerable);
 
   int denom_conv[5] = { 4, 0, 1, 2, 3 };
   /* Preallocate for efficiency. These hold result from last direction
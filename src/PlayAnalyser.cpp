@@ -10,9 +10,12 @@
 
 #include "dds.h"
 #include "threadmem.h"
+#include "Init.h"
 #include "SolverIF.h"
 #include "PBN.h"
 #include "Scheduler.h"
+#include "SolveBoard.h"
+#include "Recorder.h"
 
 // Only single-threaded debugging here.
 #define DEBUG 0
@@ -34,6 +37,32 @@ FILE *fp;
 #endif
 
 
+void PlayBounds(
+  int                   thrId,
+  int                   remainder,
+  int                   side,
+  int                   declarer);
+
+
+void PlayBounds(
+  int                   thrId,
+  int                   remainder,
+  int                   side,
+  int                   declarer)
+{
+  // The bounds of a search that ran past the batch deadline are
+  // for the side to play.  They become bounds on the declarer's
+  // tricks, in the same way as the score.
+
+  localVarType * thrp = &localVar[thrId];
+  int lower = thrp->lowerBound;
+  int upper = thrp->upperBound;
+
+  thrp->lowerBound = declarer + (side ? remainder - upper : lower);
+  thrp->upperBound = declarer + (side ? remainder - lower : upper);
+}
+
+
 
 int STDCALL AnalysePlayBin(
   deal                  dl,
@@ -45,13 +74,22 @@ int STDCALL AnalysePlayBin(
   futureTricks fut;
   int ret;
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordAnalysePlay(&dl, &play, thrId);
+
   int last_trick  = (play.number+3) / 4;
   if (last_trick > 12) last_trick = 12;
   int last_card   = ((play.number+3) % 4) + 1;
   solvedp->number = 0;
 
   ret = SolveBoard(dl, -1, 1, 1, &fut, thrId);
-  if (ret != RETURN_NO_FAULT)
+  if (ret == RETURN_DEADLINE)
+  {
+    PlayBounds(thrId, 13, 1, 0);
+    return ret;
+  }
+  else if (ret != RETURN_NO_FAULT)
     return ret;
 
   solvedp->tricks[0] = 13 - fut.score[0];
@@ -162,7 +200,15 @@ int STDCALL AnalysePlayBin(
 
       if ((ret = AnalyseLaterBoard(dl.first, 
         &move, hint, hintDir, &fut, thrId)) 
-        != RETURN_NO_FAULT)
+        == RETURN_DEADLINE)
+      {
+        // The cards before this one were solved.
+        PlayBounds(thrId, running_remainder, running_side,
+          running_declarer);
+        solvedp->number = offset + card;
+        return ret;
+      }
+      else if (ret != RETURN_NO_FAULT)
       {
 #if DEBUG
         fp = fopen("trace.txt", "a");
@@ -224,6 +270,121 @@ int STDCALL AnalysePlayPBN(
 }
 
 
+int STDCALL AnalysePlayAlternativesBin(
+  deal                  dl,
+  playTraceBin          play,
+  playAlternatives      * altp,
+  int                   thrId)
+{
+  // Each position is solved with solutions 3 on the same thread,
+  // and from the second one on with mode 2, so that the table of
+  // the strain goes along the trace.  The score of the card that
+  // was played is the best score of the next position, so there
+  // the search only has to find the best card.
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordPlayAlternatives(&dl, &play, thrId);
+
+  if (thrId < 0 || thrId >= noOfThreads)
+    return RETURN_THREAD_INDEX;
+
+  if (play.number < 0 || play.number > 52)
+    return RETURN_PLAY_FAULT;
+
+  localVarType * thrp = &localVar[thrId];
+  altp->number = 0;
+  int ret = RETURN_NO_FAULT;
+
+  for (int n = 0; n < play.number; n++)
+  {
+    futureTricks * futp = &altp->position[n];
+    ret = SolveBoard(dl, -1, 3, (n == 0 ? 1 : 2), futp, thrId);
+    thrp->scoreKnown = false;
+    if (ret != RETURN_NO_FAULT)
+      break;
+
+    // The card must be one that the hand could play.
+    int suit = play.suit[n];
+    int rank = play.rank[n];
+    int score = -1;
+    if (suit >= 0 && suit < DDS_SUITS && rank >= 2 && rank <= 14)
+    {
+      int hold = bitMapRank[rank] << 2;
+      for (int i = 0; i < futp->cards; i++)
+      {
+        if (futp->suit[i] == suit &&
+           (futp->rank[i] == rank || (futp->equals[i] & hold)))
+          score = futp->score[i];
+      }
+    }
+
+    if (score == -1)
+    {
+      ret = RETURN_PLAY_FAULT;
+      break;
+    }
+    altp->number = n + 1;
+
+    int played = 0;
+    while (played < 3 && dl.currentTrickRank[played] != 0)
+      played++;
+
+    int hand = handId(dl.first, played);
+    int remainder = 0;
+    for (int s = 0; s < DDS_SUITS; s++)
+      remainder += counttable[dl.remainCards[hand][s] >> 2];
+
+    deal next;
+    DealAfterCard(&dl, suit, rank, &next);
+
+    // The score is for the side of hand, and it includes the trick
+    // that the card may end.
+    if (played < 3)
+      thrp->knownScore = remainder - score;
+    else if (next.first % 2 == hand % 2)
+      thrp->knownScore = score - 1;
+    else
+      thrp->knownScore = remainder - score - 1;
+
+    thrp->scoreKnown = true;
+    dl = next;
+  }
+
+  thrp->scoreKnown = false;
+  return ret;
+}
+
+
+int STDCALL AnalysePlayAlternativesPBN(
+  dealPBN               dlPBN,
+  playTracePBN          playPBN,
+  playAlternatives      * altp,
+  int                   thrId)
+{
+  deal                  dl;
+  playTraceBin          play;
+
+  if (ConvertFromPBN(dlPBN.remainCards, dl.remainCards) !=
+    RETURN_NO_FAULT)
+      return RETURN_PBN_FAULT;
+
+  dl.first = dlPBN.first;
+  dl.trump = dlPBN.trump;
+  for (int i = 0; i <= 2; i++)
+  {
+    dl.currentTrickSuit[i] = dlPBN.currentTrickSuit[i];
+    dl.currentTrickRank[i] = dlPBN.currentTrickRank[i];
+  }
+
+  if (ConvertPlayFromPBN(&playPBN, &play) !=
+    RETURN_NO_FAULT)
+      return RETURN_PLAY_FAULT;
+
+  return AnalysePlayAlternativesBin(dl, play, altp, thrId);
+}
+
+
 long                    pchunk = 0;
 int                     pfail;
 
@@ -241,8 +402,8 @@ DWORD CALLBACK SolveChunkTracePlay (void *);
 
 DWORD CALLBACK SolveChunkTracePlay (void *)
 {
-  solvedPlay solved[MAXNOOFBOARDS];
   int thid;
+  RecordScope rec;
 
   thid = InterlockedIncrement(&pthreadIndex);
 
@@ -255,19 +416,29 @@ DWORD CALLBACK SolveChunkTracePlay (void *)
     if (index == -1)
       break;
 
+    // Past the deadline the boards that are left are skipped.
+    if (BatchExpired())
+    {
+      traceparam.solvedp->solved[index].number = 0;
+      continue;
+    }
+
+    // The result goes straight to the caller.  It only counts if
+    // the board was solved.
     START_THREAD_TIMER(thid);
     int res = AnalysePlayBin(
       playparam.bop->deals[index], 
       traceparam.plp->plays[index],
-      &solved[index],
+      &traceparam.solvedp->solved[index],
       thid);
     END_THREAD_TIMER(thid);
 
-    if (res == 1)
-      traceparam.solvedp->solved[index] = solved[index];
-    else
+    if (! BatchResult(index, res, thid))
+    {
+      traceparam.solvedp->solved[index].number = 0;
       pfail = res;
       /* If there are multiple errors, this will catch one of them */
+    }
   }
 
   if (SetEvent(solveAllPlayEvents[thid]) == 0)
@@ -290,6 +461,10 @@ int STDCALL AnalyseAllPlaysBin(
   if (bop->noOfBoards != plp->noOfBoards)
     return RETURN_UNKNOWN_FAULT;
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordAnalyseAllPlays(bop, plp, chunkSize);
+
   pchunk = chunkSize;
   pfail  = 1;
 
@@ -305,6 +480,10 @@ int STDCALL AnalyseAllPlaysBin(
   traceparam.noOfBoards = bop->noOfBoards;
   traceparam.solvedp = solvedp;
 
+  ReleaseIdleThreads();
+  StartBatchDeadline();
+  BatchBegin(bop->noOfBoards);
+
   scheduler.RegisterTraceDepth(plp, bop->noOfBoards);
   scheduler.Register(bop, SCHEDULER_TRACE);
 
@@ -312,7 +491,7 @@ int STDCALL AnalyseAllPlaysBin(
   {
     solveAllPlayEvents[k] = CreateEvent(NULL, FALSE, FALSE, 0);
     if (solveAllPlayEvents[k] == 0)
-      return RETURN_THREAD_CREATE;
+      return BatchFinish(RETURN_THREAD_CREATE);
   }
 
   for (int k = 0; k < noOfThreads; k++)
@@ -320,7 +499,7 @@ int STDCALL AnalyseAllPlaysBin(
     res = QueueUserWorkItem(SolveChunkTracePlay, NULL, 
                             WT_EXECUTELONGFUNCTION);
     if (res != 1)
-      return res;
+      return BatchFinish(res);
   }
 
   START_BLOCK_TIMER;
@@ -330,14 +509,14 @@ int STDCALL AnalyseAllPlaysBin(
   END_BLOCK_TIMER;
 
   if (solveAllWaitResult != WAIT_OBJECT_0)
-    return RETURN_THREAD_WAIT;
+    return BatchFinish(RETURN_THREAD_WAIT);
 
   for (int k = 0; k < noOfThreads; k++)
     CloseHandle(solveAllPlayEvents[k]);
 
   solvedp->noOfBoards = bop->noOfBoards;
 
-  return pfail;
+  return BatchFinish(pfail);
 }
 
 #else
@@ -354,11 +533,18 @@ int STDCALL AnalyseAllPlaysBin(
   if (bop->noOfBoards != plp->noOfBoards)
     return RETURN_UNKNOWN_FAULT;
 
+  RecordScope rec;
+  if (rec.Active())
+    RecordAnalyseAllPlays(bop, plp, chunkSize);
+
   pchunk = chunkSize;
   pfail  = 1;
 
   int res;
-  solvedPlay solved[MAXNOOFBOARDS];
+
+  ReleaseIdleThreads();
+  StartBatchDeadline();
+  BatchBegin(bop->noOfBoards);
 
   scheduler.RegisterTraceDepth(plp, bop->noOfBoards);
   scheduler.Register(bop, SCHEDULER_TRACE);
@@ -376,8 +562,10 @@ int STDCALL AnalyseAllPlaysBin(
 
   START_BLOCK_TIMER;
 
-  #pragma omp parallel default(none) shared(scheduler, bop, plp, solvedp, solved, pchunk, pfail) private(st, index, thid, res)
+  #pragma omp parallel default(none) shared(scheduler, bop, plp, solvedp, pchunk, pfail) private(st, index, thid, res)
   {
+    RecordScope inner;
+
     #pragma omp while schedule(dynamic, pchunk)
 
     while (1)
@@ -393,17 +581,27 @@ int STDCALL AnalyseAllPlaysBin(
       if (index == -1)
         break;
 
+      // Past the deadline the boards that are left are skipped.
+      if (BatchExpired())
+      {
+        solvedp->solved[index].number = 0;
+        continue;
+      }
+
+      // The result goes straight to the caller.  It only counts 
+      // if the board was solved.
       START_THREAD_TIMER(thid);
       res = AnalysePlayBin(bop->deals[index], 
                          plp->plays[index],
-                         &solved[index],
+                         &solvedp->solved[index],
                          thid);
       END_THREAD_TIMER(thid);
 
-      if (res == 1)
-        solvedp->solved[index] = solved[index];
-      else
+      if (! BatchResult(index, res, thid))
+      {
+        solvedp->solved[index].number = 0;
         pfail = res;
+      }
     }
   }
 
@@ -411,7 +609,7 @@ int STDCALL AnalyseAllPlaysBin(
 
   solvedp->noOfBoards = bop->noOfBoards;
 
-  return pfail;
+  return BatchFinish(pfail);
 }
 #endif
 
@@ -0,0 +1,267 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+/*
+   Pondering for card-play programs.  While the other side thinks
+   about its card, StartPonder() solves the positions after each
+   card that it may play, in a background thread on one thread
+   slot.  Once the card is known, PonderSolve() gives the result
+   from what was solved, or else solves the position on the same
+   slot, whose table by then knows the deal well.
+
+   The position itself is solved first with solutions = 3.  That
+   puts the deal into the table, and its scores give the order:
+   The cards that are best for the side to play come first, as
+   those are the ones it is most likely to play.
+
+   StopPonder() raises ponderStop, which the search of the slot
+   checks along with the batch deadline, so it does not have to
+   wait for the position that is being solved.  That search and
+   the table of its strain are given up.
+*/
+
+
+#include <atomic>
+#include <thread>
+
+#include "dds.h"
+#include "threadmem.h"
+#include "SolveBoard.h"
+#include "Recorder.h"
+
+
+struct ponderEntryType
+{
+  deal                  dl;
+  bool                  done;
+  futureTricks          fut;
+};
+
+deal                    ponderDeal;
+int                     ponderTarget,
+                        ponderSolutions,
+                        ponderMode,
+                        ponderThrId = -1;
+
+ponderEntryType         ponderList[13];
+int                     ponderCount = 0;
+
+std::thread             ponderWorker;
+std::atomic<bool>       ponderStop(false);
+
+// A worker that still runs when the library is unloaded would
+// otherwise take the program down with it.
+struct ponderGuardType
+{
+  ~ponderGuardType() { StopPonder(); }
+};
+
+ponderGuardType         ponderGuard;
+
+
+bool PonderSame(
+  const deal            * dl1,
+  const deal            * dl2);
+
+void PonderRun();
+
+
+void DealAfterCard(
+  const deal            * dl,
+  int                   suit,
+  int                   rank,
+  deal                  * child)
+{
+  // The position after the card (suit, rank) of the hand to play.
+
+  int played = 0;
+  while (played < 3 && dl->currentTrickRank[played] != 0)
+    played++;
+
+  int hand;
+  hand = handId(dl->first, played);
+
+  * child = * dl;
+  child->remainCards[hand][suit] ^=
+    static_cast<unsigned>(bitMapRank[rank] << 2);
+
+  if (played < 3)
+  {
+    child->currentTrickSuit[played] = suit;
+    child->currentTrickRank[played] = rank;
+    return;
+  }
+
+  // The card ends the trick, so the winner leads to the next one.
+  int bestSuit = dl->currentTrickSuit[0];
+  int bestRank = dl->currentTrickRank[0];
+  int bestNo   = 0;
+
+  for (int k = 1; k <= 3; k++)
+  {
+    int s = (k == 3 ? suit : dl->currentTrickSuit[k]);
+    int r = (k == 3 ? rank : dl->currentTrickRank[k]);
+
+    if ((s == bestSuit && r > bestRank) ||
+        (s == dl->trump && bestSuit != dl->trump))
+    {
+      bestSuit = s;
+      bestRank = r;
+      bestNo   = k;
+    }
+  }
+
+  child->first = handId(dl->first, bestNo);
+  for (int k = 0; k <= 2; k++)
+  {
+    child->currentTrickSuit[k] = 0;
+    child->currentTrickRank[k] = 0;
+  }
+}
+
+
+bool PonderSame(
+  const deal            * dl1,
+  const deal            * dl2)
+{
+  if (dl1->trump != dl2->trump || dl1->first != dl2->first)
+    return false;
+
+  for (int k = 0; k <= 2; k++)
+  {
+    if (dl1->currentTrickRank[k] != dl2->currentTrickRank[k])
+      return false;
+    if (dl1->currentTrickRank[k] != 0 &&
+        dl1->currentTrickSuit[k] != dl2->currentTrickSuit[k])
+      return false;
+  }
+
+  return (memcmp(dl1->remainCards, dl2->remainCards,
+    sizeof(dl1->remainCards)) == 0);
+}
+
+
+void PonderRun()
+{
+  RecordScope rec;
+
+  futureTricks all;
+  if (SolveBoard(ponderDeal, -1, 3, 1, &all, ponderThrId)
+      != RETURN_NO_FAULT)
+    return;
+
+  // The cards in the order of their scores, each followed by the
+  // cards that are equal to it.
+
+  ponderCount = 0;
+  for (int i = 0; i < all.cards; i++)
+  {
+    int suit = all.suit[i];
+    for (int r = 14; r >= 2; r--)
+    {
+      if (r != all.rank[i] && (all.equals[i] & (bitMapRank[r] << 2)) == 0)
+        continue;
+
+      ponderEntryType * pp = &ponderList[ponderCount++];
+      DealAfterCard(&ponderDeal, suit, r, &pp->dl);
+      pp->done = false;
+    }
+  }
+
+  for (int n = 0; n < ponderCount; n++)
+  {
+    if (ponderStop)
+      return;
+
+    ponderEntryType * pp = &ponderList[n];
+    if (SolveBoard(pp->dl, ponderTarget, ponderSolutions, ponderMode,
+        &pp->fut, ponderThrId) == RETURN_NO_FAULT)
+      pp->done = true;
+  }
+}
+
+
+void STDCALL StopPonder()
+{
+  ponderStop = true;
+  if (ponderWorker.joinable())
+    ponderWorker.join();
+
+  if (ponderThrId != -1)
+    localVar[ponderThrId].stopFlag = nullptr;
+  ponderStop = false;
+}
+
+
+int STDCALL StartPonder(
+  deal                  dl,
+  int                   target,
+  int                   solutions,
+  int                   mode,
+  int                   thrId)
+{
+  StopPonder();
+
+  if (thrId < 0 || thrId >= noOfThreads)
+    return RETURN_THREAD_INDEX;
+
+  ponderDeal      = dl;
+  ponderTarget    = target;
+  ponderSolutions = solutions;
+  ponderMode      = mode;
+  ponderThrId     = thrId;
+  ponderCount     = 0;
+
+  localVar[thrId].stopFlag = &ponderStop;
+  try
+  {
+    ponderWorker = std::thread(PonderRun);
+  }
+  catch (...)
+  {
+    localVar[thrId].stopFlag = nullptr;
+    return RETURN_THREAD_CREATE;
+  }
+  return RETURN_NO_FAULT;
+}
+
+
+int STDCALL PonderSolve(
+  deal                  dl,
+  int                   target,
+  int                   solutions,
+  int                   mode,
+  futureTricks          * futp)
+{
+  StopPonder();
+
+  int thrId = (ponderThrId == -1 ? 0 : ponderThrId);
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordSolveBoard(&dl, target, solutions, mode, thrId);
+
+  if (target == ponderTarget &&
+      solutions == ponderSolutions &&
+      mode == ponderMode)
+  {
+    for (int n = 0; n < ponderCount; n++)
+    {
+      ponderEntryType * pp = &ponderList[n];
+      if (pp->done && PonderSame(&pp->dl, &dl))
+      {
+        * futp = pp->fut;
+        return RETURN_NO_FAULT;
+      }
+    }
+  }
+
+  return SolveBoard(dl, target, solutions, mode, futp, thrId);
+}
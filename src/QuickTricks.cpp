@@ -11,6 +11,7 @@
 #include "dds.h"
 #include "threadmem.h"
 #include "QuickTricks.h"
+#include "SuitTricks.h"
 
 
 int QtricksLeadHandNT(
@@ -632,6 +633,29 @@ int QuickTricks(
   }
   while (suit <= 3);
 
+  /* Tricks in a row from the single-suit table, which also knows
+     about finesses and other plays that keep the lead. */
+  for (int ss = 0; ss < DDS_SUITS; ss++)
+  {
+    if ((trump != DDS_NOTRUMP) && (ss != trump) &&
+        ((len[lho[hand]][trump] != 0) || 
+         (len[rho[hand]][trump] != 0)))
+      continue;
+
+    if (Max(len[hand][ss], len[partner[hand]][ss]) < cutoff)
+      continue;
+
+    unsigned short winMask;
+    int stricks = SuitTricks(posPoint, hand, ss, &winMask);
+    if (stricks >= cutoff)
+    {
+      for (int s = 0; s < DDS_SUITS; s++)
+        posPoint->winRanks[depth][s] = 0;
+      posPoint->winRanks[depth][ss] = winMask;
+      return stricks;
+    }
+  }
+
   if (qtricks == 0)
   {
     if ((trump == DDS_NOTRUMP) || (winner[trump].hand == -1))
@@ -0,0 +1,341 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "dds.h"
+#include "Recorder.h"
+
+/*
+   Each record is built in a buffer and written under a lock, so
+   records from different threads are never interleaved.  The
+   payloads are:
+
+   deal            trump, first, currentTrickSuit[3] and
+                   currentTrickRank[3] as bytes, then the 16
+                   holdings as unsigned shorts.  40 bytes.
+   trace           number as a byte, then number pairs of suit
+                   and rank as bytes.
+   cards           the 16 holdings as unsigned shorts.
+
+   SOLVEBOARD      deal, target, solutions, mode as bytes.
+   SOLVEALL        noOfBoards as a short, chunkSize as a byte,
+                   then per board deal, target, solutions, mode.
+   CALCDDTABLE     cards.
+   CALCALLTABLES   noOfTables as a short, mode as a byte and the
+                   five trumpFilter bytes, then per table cards.
+   PAR             the 20 resTable entries and vulnerable as bytes.
+   ANALYSEPLAY     deal, trace.
+   ALTERNATIVES    deal, trace.
+   ANALYSEALLPLAYS noOfBoards as a short, chunkSize as a byte,
+                   then per board deal, trace.
+*/
+
+typedef std::vector<unsigned char> recBufType;
+
+std::atomic<bool>       recActive(false);
+std::mutex              recMutex;
+FILE                    * recFile = nullptr;
+std::chrono::steady_clock::time_point recStart;
+
+thread_local int        recDepth = 0;
+
+
+void RecStart(
+  recBufType            & buf,
+  int                   type,
+  int                   thrId);
+
+void RecWrite(
+  const recBufType      & buf);
+
+void PutByte(
+  recBufType            & buf,
+  int                   value);
+
+void PutShort(
+  recBufType            & buf,
+  int                   value);
+
+void PutCards(
+  recBufType            & buf,
+  const unsigned        cards[DDS_HANDS][DDS_SUITS]);
+
+void PutDeal(
+  recBufType            & buf,
+  const deal            * dl);
+
+void PutTrace(
+  recBufType            & buf,
+  const playTraceBin    * play);
+
+
+int STDCALL StartRecording(
+  const char            * fname)
+{
+  std::lock_guard<std::mutex> lock(recMutex);
+
+  if (recFile)
+    fclose(recFile);
+
+  recActive = false;
+  recFile = fopen(fname, "wb");
+  if (! recFile)
+    return RETURN_UNKNOWN_FAULT;
+
+  int version = DDS_VERSION;
+  fwrite("DDSR", 1, 4, recFile);
+  fwrite(&version, sizeof(version), 1, recFile);
+
+  recStart = std::chrono::steady_clock::now();
+  recActive = true;
+  return RETURN_NO_FAULT;
+}
+
+
+void STDCALL StopRecording()
+{
+  std::lock_guard<std::mutex> lock(recMutex);
+
+  recActive = false;
+  if (recFile)
+    fclose(recFile);
+  recFile = nullptr;
+}
+
+
+RecordScope::RecordScope()
+{
+  recDepth++;
+}
+
+
+RecordScope::~RecordScope()
+{
+  recDepth--;
+}
+
+
+bool RecordScope::Active() const
+{
+  return (recDepth == 1 && recActive);
+}
+
+
+void RecStart(
+  recBufType            & buf,
+  int                   type,
+  int                   thrId)
+{
+  long long t = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - recStart).count();
+
+  buf.reserve(256);
+  PutByte(buf, type);
+  PutByte(buf, thrId);
+
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(&t);
+  buf.insert(buf.end(), p, p + sizeof(t));
+}
+
+
+void RecWrite(
+  const recBufType      & buf)
+{
+  std::lock_guard<std::mutex> lock(recMutex);
+
+  if (recFile)
+    fwrite(buf.data(), 1, buf.size(), recFile);
+}
+
+
+void PutByte(
+  recBufType            & buf,
+  int                   value)
+{
+  buf.push_back(static_cast<unsigned char>(value));
+}
+
+
+void PutShort(
+  recBufType            & buf,
+  int                   value)
+{
+  unsigned short v = static_cast<unsigned short>(value);
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(&v);
+  buf.insert(buf.end(), p, p + sizeof(v));
+}
+
+
+void PutCards(
+  recBufType            & buf,
+  const unsigned        cards[DDS_HANDS][DDS_SUITS])
+{
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      PutShort(buf, static_cast<int>(cards[h][s]));
+}
+
+
+void PutDeal(
+  recBufType            & buf,
+  const deal            * dl)
+{
+  PutByte(buf, dl->trump);
+  PutByte(buf, dl->first);
+  for (int k = 0; k < 3; k++)
+    PutByte(buf, dl->currentTrickSuit[k]);
+  for (int k = 0; k < 3; k++)
+    PutByte(buf, dl->currentTrickRank[k]);
+  PutCards(buf, dl->remainCards);
+}
+
+
+void PutTrace(
+  recBufType            & buf,
+  const playTraceBin    * play)
+{
+  int number = play->number;
+  if (number < 0)
+    number = 0;
+  else if (number > 52)
+    number = 52;
+
+  PutByte(buf, number);
+  for (int k = 0; k < number; k++)
+  {
+    PutByte(buf, play->suit[k]);
+    PutByte(buf, play->rank[k]);
+  }
+}
+
+
+void RecordSolveBoard(
+  const deal            * dl,
+  int                   target,
+  int                   solutions,
+  int                   mode,
+  int                   thrId)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_SOLVEBOARD, thrId);
+  PutDeal(buf, dl);
+  PutByte(buf, target);
+  PutByte(buf, solutions);
+  PutByte(buf, mode);
+  RecWrite(buf);
+}
+
+
+void RecordSolveAll(
+  const boards          * bop,
+  int                   chunkSize)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_SOLVEALL, 0);
+  PutShort(buf, bop->noOfBoards);
+  PutByte(buf, chunkSize);
+  for (int b = 0; b < bop->noOfBoards; b++)
+  {
+    PutDeal(buf, &bop->deals[b]);
+    PutByte(buf, bop->target[b]);
+    PutByte(buf, bop->solutions[b]);
+    PutByte(buf, bop->mode[b]);
+  }
+  RecWrite(buf);
+}
+
+
+void RecordCalcDDtable(
+  const ddTableDeal     * tableDeal)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_CALCDDTABLE, 0);
+  PutCards(buf, tableDeal->cards);
+  RecWrite(buf);
+}
+
+
+void RecordCalcAllTables(
+  const ddTableDeals    * dealsp,
+  int                   mode,
+  const int             trumpFilter[5])
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_CALCALLTABLES, 0);
+  PutShort(buf, dealsp->noOfTables);
+  PutByte(buf, mode);
+  for (int k = 0; k < DDS_STRAINS; k++)
+    PutByte(buf, trumpFilter[k]);
+  for (int m = 0; m < dealsp->noOfTables; m++)
+    PutCards(buf, dealsp->deals[m].cards);
+  RecWrite(buf);
+}
+
+
+void RecordPar(
+  const ddTableResults  * tablep,
+  int                   vulnerable)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_PAR, 0);
+  for (int s = 0; s < DDS_STRAINS; s++)
+    for (int h = 0; h < DDS_HANDS; h++)
+      PutByte(buf, tablep->resTable[s][h]);
+  PutByte(buf, vulnerable);
+  RecWrite(buf);
+}
+
+
+void RecordAnalysePlay(
+  const deal            * dl,
+  const playTraceBin    * play,
+  int                   thrId)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_ANALYSEPLAY, thrId);
+  PutDeal(buf, dl);
+  PutTrace(buf, play);
+  RecWrite(buf);
+}
+
+
+void RecordPlayAlternatives(
+  const deal            * dl,
+  const playTraceBin    * play,
+  int                   thrId)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_ALTERNATIVES, thrId);
+  PutDeal(buf, dl);
+  PutTrace(buf, play);
+  RecWrite(buf);
+}
+
+
+void RecordAnalyseAllPlays(
+  const boards          * bop,
+  const playTracesBin   * plp,
+  int                   chunkSize)
+{
+  recBufType buf;
+  RecStart(buf, DDS_REC_ANALYSEALLPLAYS, 0);
+  PutShort(buf, bop->noOfBoards);
+  PutByte(buf, chunkSize);
+  for (int b = 0; b < bop->noOfBoards; b++)
+  {
+    PutDeal(buf, &bop->deals[b]);
+    PutTrace(buf, &plp->plays[b]);
+  }
+  RecWrite(buf);
+}
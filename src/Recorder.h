@@ -0,0 +1,72 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#ifndef DDS_RECORDERH
+#define DDS_RECORDERH
+
+/*
+   The recorder writes the inputs of the exported calls to the log
+   opened by StartRecording().  Each recorded function declares a
+   RecordScope first.  Only the outermost scope on a thread records,
+   so calls that the library makes to itself are not logged twice.
+   The library's own worker threads also declare a scope, so the
+   boards of a batch are only recorded as part of the batch.
+*/
+
+class RecordScope
+{
+  public:
+
+    RecordScope();
+
+    ~RecordScope();
+
+    bool Active() const;
+};
+
+void RecordSolveBoard(
+  const deal            * dl,
+  int                   target,
+  int                   solutions,
+  int                   mode,
+  int                   thrId);
+
+void RecordSolveAll(
+  const boards          * bop,
+  int                   chunkSize);
+
+void RecordCalcDDtable(
+  const ddTableDeal     * tableDeal);
+
+void RecordCalcAllTables(
+  const ddTableDeals    * dealsp,
+  int                   mode,
+  const int             trumpFilter[5]);
+
+void RecordPar(
+  const ddTableResults  * tablep,
+  int                   vulnerable);
+
+void RecordAnalysePlay(
+  const deal            * dl,
+  const playTraceBin    * play,
+  int                   thrId);
+
+void RecordPlayAlternatives(
+  const deal            * dl,
+  const playTraceBin    * play,
+  int                   thrId);
+
+void RecordAnalyseAllPlays(
+  const boards          * bop,
+  const playTracesBin   * plp,
+  int                   chunkSize);
+
+#endif
@@ -8,7 +8,14 @@
 */
 
 
+#include <chrono>
+#include <thread>
+
 #include "Scheduler.h"
+#include "Init.h"
+
+
+long long MicroTime();
 
 
 Scheduler::Scheduler()
@@ -31,6 +38,11 @@ Scheduler::Scheduler()
 
   numHands  = 0;
 
+  deterministic = false;
+  shortestFirst = false;
+
+  Scheduler::ResetThreadStats();
+
 #ifdef DDS_SCHEDULER
   Scheduler::InitTimes();
 
@@ -149,7 +161,11 @@ Scheduler::~Scheduler()
 void Scheduler::Reset()
 {
   for (int b = 0; b < MAXNOOFBOARDS; b++)
-    hands[b].next = -1;
+  {
+    hands[b].next     = -1;
+    group[b].repeatNo = 0;
+    group[b].left     = 0;
+  }
 
   numGroups   = 0;
   extraGroups = 0;
@@ -164,9 +180,16 @@ void Scheduler::Reset()
   {
     threadGroup[t]     = -1;
     threadCurrGroup[t] = -1;
+    threadStats[t].running = false;
+
+    splitFirst[t] = -1;
+    splitHead[t]  = -1;
+    seedFor[t]    = -1;
+    seedReady[t]  = false;
   }
 
   currGroup = -1;
+  splitOn   = false;
 }
 
 
@@ -206,6 +229,11 @@ void Scheduler::Register(
 
   // Make predictions per group.
 
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  // With calc, the repeated hands are only copied anyway.
+  splitOn = (sortMode == SCHEDULER_SOLVE && ! deterministic);
+#endif
+
   if (sortMode == SCHEDULER_SOLVE)
     Scheduler::SortSolve();
   else if (sortMode == SCHEDULER_CALC)
@@ -435,6 +463,17 @@ double SORT_SOLVE_FANOUT[2][5] =
   { 30., 50., 0.08144,  1.629, 12. }
 };
 
+
+bool Scheduler::SortBefore(
+  int                   pred1,
+  int                   pred2) const
+{
+  // Normally the slowest groups first, so that the threads finish
+  // at about the same time.
+  return (shortestFirst ? pred1 < pred2 : pred1 > pred2);
+}
+
+
 void Scheduler::SortSolve()
 {
   listType * lp;
@@ -492,7 +531,7 @@ void Scheduler::SortSolve()
   {
     gp = group[g];
     int j = g;
-    for (; j && gp.pred > group[j-1].pred; --j)
+    for (; j && Scheduler::SortBefore(gp.pred, group[j-1].pred); --j)
       group[j] = group[j-1];
     group[j] = gp;
   }
@@ -551,7 +590,7 @@ void Scheduler::SortCalc()
   {
     gp = group[g];
     int j = g;
-    for (; j && gp.pred > group[j-1].pred; --j)
+    for (; j && Scheduler::SortBefore(gp.pred, group[j-1].pred); --j)
       group[j] = group[j-1];
     group[j] = gp;
   }
@@ -660,7 +699,7 @@ void Scheduler::SortTrace()
   {
     gp = group[g];
     int j = g;
-    for (; j && gp.pred > group[j-1].pred; --j)
+    for (; j && Scheduler::SortBefore(gp.pred, group[j-1].pred); --j)
       group[j] = group[j-1];
     group[j] = gp;
   }
@@ -726,11 +765,91 @@ int Scheduler::Fanout(
 
 schedType Scheduler::GetNumber(
   int                   thrId)
+{
+  // A thread spends the time between two calls solving, and the
+  // time within a call waiting for the next board.  The first
+  // call in a batch has nothing before it.
+
+  threadStatType * tp = &threadStats[thrId];
+  long long t0 = MicroTime();
+  if (tp->running)
+    tp->busyTime += t0 - tp->lastTime;
+
+  schedType st = Scheduler::NextNumber(thrId);
+
+  tp->lastTime  = MicroTime();
+  tp->waitTime += tp->lastTime - t0;
+  tp->running   = (st.number != -1);
+  if (tp->running)
+    tp->boards++;
+
+  return st;
+}
+
+
+void Scheduler::ResetThreadStats()
+{
+  for (int t = 0; t < MAXNOOFTHREADS; t++)
+  {
+    threadStats[t].boards   = 0;
+    threadStats[t].busyTime = 0;
+    threadStats[t].waitTime = 0;
+    threadStats[t].lastTime = 0;
+    threadStats[t].running  = false;
+  }
+}
+
+
+void Scheduler::SetDeterministic(
+  bool                  on)
+{
+  deterministic = on;
+}
+
+
+void Scheduler::SetShortestFirst(
+  bool                  on)
+{
+  shortestFirst = on;
+}
+
+
+void Scheduler::GetThreadStats(
+  int                   thrId,
+  threadStat            * tsp)
+{
+  tsp->boards   = threadStats[thrId].boards;
+  tsp->busyTime = threadStats[thrId].busyTime;
+  tsp->waitTime = threadStats[thrId].waitTime;
+}
+
+
+long long MicroTime()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+schedType Scheduler::NextNumber(
+  int                   thrId)
 {
   int g = threadGroup[thrId];
   listType  * lp;
   schedType st;
 
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  if (splitOn)
+  {
+    // This thread is between two boards, so its table can be
+    // copied now if another thread is waiting for it.
+    Scheduler::ServeSeed(thrId);
+
+    if (splitFirst[thrId] != -1)
+      return Scheduler::NextSplit(thrId);
+  }
+#endif
+
   if (g == -1)
   {
     // Find a new group
@@ -739,6 +858,10 @@ schedType Scheduler::GetNumber(
     {
       // Out of groups.  Just an optimization not to touch the
       // shared variable unnecessarily.
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+      if (splitOn && Scheduler::SplitGroup(thrId))
+        return Scheduler::NextSplit(thrId);
+#endif
       st.number = -1;
       return st;
     }
@@ -759,6 +882,10 @@ schedType Scheduler::GetNumber(
       // Out of groups.  currGroup could have changed in the 
       // meantime in another thread, so test again.
 
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+      if (splitOn && Scheduler::SplitGroup(thrId))
+        return Scheduler::NextSplit(thrId);
+#endif
       st.number = -1;
       return st;
     }
@@ -770,6 +897,7 @@ schedType Scheduler::GetNumber(
     threadCurrGroup[thrId] = g;
     group[g].repeatNo  = 0;
     group[g].actual    = 0;
+    group[g].left      = list[ group[g].strain ][ group[g].hash ].length;
   }
 
   // Continue with existing or new group
@@ -777,14 +905,25 @@ schedType Scheduler::GetNumber(
   int strain = group[g].strain;
   int key    = group[g].hash;
 
+  // Another thread may split the list of the group.
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  if (splitOn)
+    omp_set_lock(&lock);
+#endif
+
   lp         = &list[strain][key];
   st.number  = lp->first;
   lp->first  = hands[lp->first].next;
+  group[g].left--;
 
   if (group[g].repeatNo == 0)
   {
     group[g].head = st.number;
     st.repeatOf   = -1;
+
+    // The thread does not solve anything until it asks again.
+    if (deterministic)
+      ForgetDeal(thrId);
     
     // Only first-solve suited hands for statistics right now.
     hands[st.number].selectFlag = 
@@ -811,10 +950,121 @@ schedType Scheduler::GetNumber(
   if (lp->first == -1)
     threadGroup[thrId] = -1;
 
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+  if (splitOn)
+    omp_unset_lock(&lock);
+#endif
+
   return st;
 }
 
 
+#if defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
+bool Scheduler::SplitGroup(
+  int                   thrId)
+{
+  // Takes the second half of the largest group that is left, if
+  // its head has been handed out.  The thread that owns the group
+  // copies its table over once it is done with its current board,
+  // and this thread waits for that.
+
+  omp_set_lock(&lock);
+
+  int owner = -1;
+  int most  = SPLIT_MIN_LEFT - 1;
+
+  for (int t = 0; t < MAXNOOFTHREADS; t++)
+  {
+    int g = threadGroup[t];
+    if (t == thrId || g == -1 || seedFor[t] != -1)
+      continue;
+
+    if (group[g].repeatNo > 0 && group[g].left > most)
+    {
+      owner = t;
+      most  = group[g].left;
+    }
+  }
+
+  if (owner == -1)
+  {
+    omp_unset_lock(&lock);
+    return false;
+  }
+
+  int g = threadGroup[owner];
+  listType * lp = &list[ group[g].strain ][ group[g].hash ];
+
+  int keep = (most + 1) / 2;
+  int last = lp->first;
+  for (int i = 1; i < keep; i++)
+    last = hands[last].next;
+
+  splitFirst[thrId] = hands[last].next;
+  splitHead[thrId]  = group[g].head;
+
+  hands[last].next = -1;
+  lp->last         = last;
+  group[g].left    = keep;
+
+  seedFor[owner]   = thrId;
+  seedReady[thrId] = false;
+
+  omp_unset_lock(&lock);
+
+  while (1)
+  {
+    omp_set_lock(&lock);
+    bool ready = seedReady[thrId];
+    omp_unset_lock(&lock);
+
+    if (ready)
+      return true;
+
+    std::this_thread::yield();
+  }
+}
+
+
+void Scheduler::ServeSeed(
+  int                   thrId)
+{
+  omp_set_lock(&lock);
+  int toId = seedFor[thrId];
+  seedFor[thrId] = -1;
+  omp_unset_lock(&lock);
+
+  if (toId == -1)
+    return;
+
+  // If the copy fails, the other thread just starts from scratch.
+  CloneThread(thrId, toId);
+
+  omp_set_lock(&lock);
+  seedReady[toId] = true;
+  omp_unset_lock(&lock);
+}
+
+
+schedType Scheduler::NextSplit(
+  int                   thrId)
+{
+  // No other thread touches this part of the list any more.
+  schedType st;
+  st.number   = splitFirst[thrId];
+  st.repeatOf = splitHead[thrId];
+
+  splitFirst[thrId] = hands[st.number].next;
+
+  hands[st.number].selectFlag = 0;
+  hands[st.number].repeatNo   = 1;
+  threadToHand[thrId] = st.number;
+
+  return st;
+}
+#endif
+
+
 #ifdef DDS_SCHEDULER
 void Scheduler::StartThreadTimer(int thrId)
 {
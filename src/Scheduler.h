@@ -29,6 +29,12 @@
 
 #define HASH_MAX        128
 
+// A thread that runs out of groups takes over half of a group
+// that another thread is still working on, if at least this many
+// hands are left in it.  It starts out with a copy of that
+// thread's transposition table.
+#define SPLIT_MIN_LEFT    4
+
 
 struct schedType {
   int                   number,
@@ -56,7 +62,8 @@ class Scheduler
                         pred,
                         actual,
                         head,
-                        repeatNo;
+                        repeatNo,
+                        left;
     };
 
     struct sortType {
@@ -100,6 +107,33 @@ class Scheduler
 
     int                 threadToHand[MAXNOOFTHREADS];
 
+    // Each group starts from an empty table and is not split.
+    bool                deterministic;
+
+    // The groups that are predicted to be fastest come first, for
+    // a batch with a deadline.
+    bool                shortestFirst;
+
+    // The hands that a thread has taken over from another group,
+    // the head of that group, and the thread that is waiting for
+    // a copy of this thread's table.
+    bool                splitOn;
+    int                 splitFirst[MAXNOOFTHREADS],
+                        splitHead[MAXNOOFTHREADS],
+                        seedFor[MAXNOOFTHREADS];
+    bool volatile       seedReady[MAXNOOFTHREADS];
+
+    // Always kept, unlike the DDS_SCHEDULER timing below.
+    struct threadStatType {
+      int               boards;
+      long long         busyTime,
+                        waitTime,
+                        lastTime;
+      bool              running;
+    };
+
+    threadStatType      threadStats[MAXNOOFTHREADS];
+
     int                 numHands;
 
     int                 highCards[8192];
@@ -137,6 +171,22 @@ class Scheduler
          SortCalc(),
          SortTrace();
 
+    bool SortBefore(
+      int               pred1,
+      int               pred2) const;
+
+    schedType NextNumber(
+      int               thrId);
+
+    bool SplitGroup(
+      int               thrId);
+
+    void ServeSeed(
+      int               thrId);
+
+    schedType NextSplit(
+      int               thrId);
+
 #ifdef DDS_SCHEDULER
     FILE                * fp;
 
@@ -196,6 +246,18 @@ class Scheduler
     
     schedType GetNumber(
       int               thrId);
+
+    void ResetThreadStats();
+
+    void SetDeterministic(
+      bool              on);
+
+    void SetShortestFirst(
+      bool              on);
+
+    void GetThreadStats(
+      int               thrId,
+      threadStat        * tsp);
     
 #ifdef DDS_SCHEDULER
     void StartThreadTimer(
@@ -10,10 +10,12 @@
 
 #include "dds.h"
 #include "threadmem.h"
+#include "Init.h"
 #include "SolverIF.h"
 #include "SolveBoard.h"
 #include "Scheduler.h"
 #include "PBN.h"
+#include "Recorder.h"
 #include "debug.h"
 
 #ifdef DDS_SCHEDULER
@@ -30,6 +32,158 @@
 
 extern int noOfThreads;
 
+long long MicroTime();
+
+int                     batchDeadline = 0; // Milliseconds, 0 for none
+long long               batchEnd = 0;      // In MicroTime(), 0 for none
+batchStatus             batchStat;
+
+
+void STDCALL SetBatchDeadline(
+  int                   milliSeconds)
+{
+  batchDeadline = Max(milliSeconds, 0);
+}
+
+
+void STDCALL GetBatchStatus(
+  batchStatus           * statusp)
+{
+  * statusp = batchStat;
+}
+
+
+void StartBatchDeadline()
+{
+  // Called by the batch functions that take the deadline, before 
+  // they solve anything.
+  batchEnd = (batchDeadline > 0 ? 
+    MicroTime() + 1000LL * batchDeadline : 0);
+}
+
+
+void BatchBegin(
+  int                   noOfBoards)
+{
+  // Before the boards are registered with the scheduler.  The
+  // batch takes all threads, so pondering stops.
+  StopPonder();
+
+  batchStat.noOfBoards = noOfBoards;
+  for (int b = 0; b < noOfBoards; b++)
+  {
+    batchStat.status[b] = DDS_BOARD_SKIPPED;
+    batchStat.lower[b]  = 0;
+    batchStat.upper[b]  = 0;
+  }
+
+  for (int k = 0; k < MAXNOOFTHREADS; k++)
+    localVar[k].deadline = batchEnd;
+
+  scheduler.SetShortestFirst(batchEnd > 0);
+}
+
+
+bool BatchExpired()
+{
+  return (batchEnd > 0 && MicroTime() > batchEnd);
+}
+
+
+bool BatchResult(
+  int                   index,
+  int                   res,
+  int                   thrId)
+{
+  // Returns false if res is an error.
+
+  if (res == RETURN_NO_FAULT)
+  {
+    batchStat.status[index] = DDS_BOARD_SOLVED;
+    return true;
+  }
+  else if (res == RETURN_DEADLINE)
+  {
+    batchStat.status[index] = DDS_BOARD_PARTIAL;
+    batchStat.lower[index]  = localVar[thrId].lowerBound;
+    batchStat.upper[index]  = localVar[thrId].upperBound;
+    return true;
+  }
+  else
+    return false;
+}
+
+
+bool BatchRepeat(
+  int                   index,
+  int                   head)
+{
+  // A board that repeats the head board of its group gets the
+  // status and bounds of the head.  Returns false unless the head
+  // was solved, in which case there is no result to copy.
+
+  batchStat.status[index] = batchStat.status[head];
+  batchStat.lower[index]  = batchStat.lower[head];
+  batchStat.upper[index]  = batchStat.upper[head];
+  return (batchStat.status[head] == DDS_BOARD_SOLVED);
+}
+
+
+int BatchFinish(
+  int                   res)
+{
+  // The threads must not keep the deadline for later calls.
+  for (int k = 0; k < MAXNOOFTHREADS; k++)
+    localVar[k].deadline = 0;
+
+  batchEnd = 0;
+  scheduler.SetShortestFirst(false);
+
+  if (res != RETURN_NO_FAULT)
+    return res;
+
+  for (int b = 0; b < batchStat.noOfBoards; b++)
+    if (batchStat.status[b] != DDS_BOARD_SOLVED)
+      return RETURN_DEADLINE;
+
+  return RETURN_NO_FAULT;
+}
+
+
+void BatchGroup(
+  int                   size)
+{
+  // Each size boards in a row become one entry.  It is partial
+  // unless they were all solved or all skipped, and it has no
+  // bounds.
+
+  int number = batchStat.noOfBoards / size;
+
+  for (int n = 0; n < number; n++)
+  {
+    int solved = 0, skipped = 0;
+    for (int b = n * size; b < (n+1) * size; b++)
+    {
+      if (batchStat.status[b] == DDS_BOARD_SOLVED)
+        solved++;
+      else if (batchStat.status[b] == DDS_BOARD_SKIPPED)
+        skipped++;
+    }
+
+    if (solved == size)
+      batchStat.status[n] = DDS_BOARD_SOLVED;
+    else if (skipped == size)
+      batchStat.status[n] = DDS_BOARD_SKIPPED;
+    else
+      batchStat.status[n] = DDS_BOARD_PARTIAL;
+
+    batchStat.lower[n] = 0;
+    batchStat.upper[n] = 0;
+  }
+
+  batchStat.noOfBoards = number;
+}
+
 #if (defined(_WIN32) || defined(__CYGWIN__)) && \
      !defined(_OPENMP) && !defined(DDS_THREADS_SINGLE)
 HANDLE solveAllEvents[MAXNOOFTHREADS];
@@ -44,8 +198,8 @@ DWORD CALLBACK SolveChunkDDtable (void *);
 
 DWORD CALLBACK SolveChunk (void *) 
 {
-  futureTricks fut[MAXNOOFBOARDS];
   int thid;
+  RecordScope rec;
 
   thid = InterlockedIncrement(&threadIndex);
 
@@ -58,6 +212,10 @@ DWORD CALLBACK SolveChunk (void *)
     if (index == -1)
       break;
 
+    // Past the deadline the boards that are left are skipped.
+    if (BatchExpired())
+      continue;
+
     // This is not a perfect repeat detector, as the hands in
     // a group might have declarers N, S, N, N.  Then the second
     // N would not reuse the first N.  However, must reuses are
@@ -68,26 +226,33 @@ DWORD CALLBACK SolveChunk (void *)
         param.bop->deals[st.repeatOf].first)
     {
       START_THREAD_TIMER(thid);
-      param.solvedp->solvedBoard[index] = fut[ st.repeatOf ];
+      if (BatchRepeat(index, st.repeatOf))
+        param.solvedp->solvedBoard[index] = 
+          param.solvedp->solvedBoard[ st.repeatOf ];
+      else
+        param.solvedp->solvedBoard[index].cards = 0;
       END_THREAD_TIMER(thid);
       continue;
     }
     else
     {
+      // The result goes straight to the caller.  It only counts 
+      // if the board was solved.
       START_THREAD_TIMER(thid);
       int res = SolveBoard(
         param.bop->deals[index], 
         param.bop->target[index],
         param.bop->solutions[index], 
         param.bop->mode[index], 
-        &fut[index], 
+        &param.solvedp->solvedBoard[index], 
         thid);
       END_THREAD_TIMER(thid);
 
-      if (res == 1)
-        param.solvedp->solvedBoard[index] = fut[index];
-      else
+      if (! BatchResult(index, res, thid))
+      {
+        param.solvedp->solvedBoard[index].cards = 0;
         param.error = res;
+      }
     }
   }
 
@@ -101,8 +266,9 @@ DWORD CALLBACK SolveChunk (void *)
 
 DWORD CALLBACK SolveChunkDDtable (void *) 
 {
-  futureTricks fut[MAXNOOFBOARDS];
+  futureTricks fut;
   int thid;
+  RecordScope rec;
 
   thid = InterlockedIncrement(&threadIndex);
 
@@ -116,15 +282,26 @@ DWORD CALLBACK SolveChunkDDtable (void *)
     if (index == -1)
       break;
 
+    // The scores that are not solved in time stay at -1.
+    for (int k = 0; k < chunk; k++)
+      param.solvedp->solvedBoard[index].score[k] = -1;
+
+    // Past the deadline the boards that are left are skipped.
+    if (BatchExpired())
+      continue;
+
     if (st.repeatOf != -1)
     {
       START_THREAD_TIMER(thid);
+      bool solved = BatchRepeat(index, st.repeatOf);
       for (int k = 0; k < chunk; k++)
       {
         param.bop->deals[index].first = k;
 
-        param.solvedp->solvedBoard[index].score[k] =
-          param.solvedp->solvedBoard[ st.repeatOf ].score[k];
+        // The scores stay at -1 unless the head was solved.
+        if (solved)
+          param.solvedp->solvedBoard[index].score[k] =
+            param.solvedp->solvedBoard[ st.repeatOf ].score[k];
       }
       END_THREAD_TIMER(thid);
       continue;
@@ -138,35 +315,34 @@ DWORD CALLBACK SolveChunkDDtable (void *)
         param.bop->target[index],
         param.bop->solutions[index], 
         param.bop->mode[index], 
-        &fut[index], 
+        &fut, 
         thid);
 
     // SH: I'm making a terrible use of the fut structure here.
 
     if (res == 1)
-      param.solvedp->solvedBoard[index].score[0] = fut[index].score[0];
-    else
-      param.error = res;
+      param.solvedp->solvedBoard[index].score[0] = fut.score[0];
 
-    for (int k = 1; k < chunk; k++) 
+    for (int k = 1; k < chunk && res == 1; k++) 
     {
-      int hint = (k == 2 ? fut[index].score[0] : 
-                  13 - fut[index].score[0]);
+      int hint = (k == 2 ? fut.score[0] : 
+                  13 - fut.score[0]);
 
       param.bop->deals[index].first = k; // Next declarer
 
       res = SolveSameBoard(
         param.bop->deals[index], 
-        &fut[index], 
+        &fut, 
         hint,
         thid);
 
       if (res == 1)
         param.solvedp->solvedBoard[index].score[k] = 
-          fut[index].score[0];
-      else
-        param.error = res;
+          fut.score[0];
     }
+
+    if (! BatchResult(index, res, thid))
+      param.error = res;
     END_THREAD_TIMER(thid);
   }
 
@@ -193,25 +369,32 @@ int SolveAllBoardsN(
   param.error = 0;
 
   if (bop->noOfBoards > MAXNOOFBOARDS)
-    return RETURN_TOO_MANY_BOARDS;
+    return BatchFinish(RETURN_TOO_MANY_BOARDS);
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordSolveAll(bop, chunkSize);
 
   for (k = 0; k < noOfThreads; k++) 
   {
     solveAllEvents[k] = CreateEvent(NULL, FALSE, FALSE, 0);
     if (solveAllEvents[k] == 0) 
-        return RETURN_THREAD_CREATE;
+        return BatchFinish(RETURN_THREAD_CREATE);
   }
 
   param.bop        = bop; 
   param.solvedp    = solvedp; 
   param.noOfBoards = bop->noOfBoards;
 
+  ReleaseIdleThreads();
+  BatchBegin(bop->noOfBoards);
+
   if (source == 0)
     scheduler.Register(bop, SCHEDULER_SOLVE);
   else
     scheduler.Register(bop, SCHEDULER_CALC);
 
-  for (k = 0; k < MAXNOOFBOARDS; k++)
+  for (k = 0; k < bop->noOfBoards; k++)
     solvedp->solvedBoard[k].cards = 0;
 
   if (chunkSize != 1) 
@@ -221,7 +404,7 @@ int SolveAllBoardsN(
       res = QueueUserWorkItem(SolveChunkDDtable, NULL, 
         WT_EXECUTELONGFUNCTION);
       if (res != 1) 
-        return res;
+        return BatchFinish(res);
     }
   }
   else 
@@ -231,7 +414,7 @@ int SolveAllBoardsN(
       res=QueueUserWorkItem(SolveChunk, NULL, 
         WT_EXECUTELONGFUNCTION);
       if (res != 1) 
-        return res;
+        return BatchFinish(res);
     }
   }
 
@@ -242,7 +425,7 @@ int SolveAllBoardsN(
   END_BLOCK_TIMER;
 
   if (solveAllWaitResult != WAIT_OBJECT_0)
-    return RETURN_THREAD_WAIT;
+    return BatchFinish(RETURN_THREAD_WAIT);
 
   for (k = 0; k<noOfThreads; k++)
     CloseHandle(solveAllEvents[k]);
@@ -252,9 +435,9 @@ int SolveAllBoardsN(
   solvedp->noOfBoards = param.noOfBoards;
 
   if (param.error == 0)
-    return 1;
+    return BatchFinish(1);
   else
-    return param.error;
+    return BatchFinish(param.error);
 }
 
 #else
@@ -266,14 +449,18 @@ int SolveAllBoardsN(
   int                   source) // 0 solve, 1 calc
 {
   int k, i, res, chunk, fail;
-  futureTricks fut[MAXNOOFBOARDS];
+  futureTricks fut;
 
   chunk=chunkSize; fail=1;
 
   if (bop->noOfBoards > MAXNOOFBOARDS)
-    return RETURN_TOO_MANY_BOARDS;
+    return BatchFinish(RETURN_TOO_MANY_BOARDS);
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordSolveAll(bop, chunkSize);
 
-  for (i = 0; i < MAXNOOFBOARDS; i++)
+  for (i = 0; i < bop->noOfBoards; i++)
       solvedp->solvedBoard[i].cards = 0;
 
 #if defined (_OPENMP) && !defined(DDS_THREADS_SINGLE)
@@ -288,6 +475,9 @@ int SolveAllBoardsN(
   int index, thid, hint;
   schedType st;
 
+  ReleaseIdleThreads();
+  BatchBegin(bop->noOfBoards);
+
   START_BLOCK_TIMER;
 
   if (source == 0)
@@ -297,8 +487,10 @@ int SolveAllBoardsN(
 
   if (chunkSize == 1)
   {
-    #pragma omp parallel default(none) shared(scheduler, fut, bop, solvedp, chunk, fail) private(st, index, thid, res)
+    #pragma omp parallel default(none) shared(scheduler, bop, solvedp, chunk, fail) private(st, index, thid, res)
     {
+      RecordScope inner;
+
       #pragma omp while schedule(dynamic, chunk)
 
       while (1)
@@ -314,6 +506,10 @@ int SolveAllBoardsN(
         if (index == -1)
           break;
 
+        // Past the deadline the boards that are left are skipped.
+        if (BatchExpired())
+          continue;
+
         // This is not a perfect repeat detector, as the hands in
         // a group might have declarers N, S, N, N.  Then the second
         // N would not reuse the first N.  However, must reuses are
@@ -324,26 +520,33 @@ int SolveAllBoardsN(
              bop->deals[st.repeatOf].first))
         {
           START_THREAD_TIMER(thid);
-          solvedp->solvedBoard[index] = fut[ st.repeatOf ];
+          if (BatchRepeat(index, st.repeatOf))
+            solvedp->solvedBoard[index] = 
+              solvedp->solvedBoard[ st.repeatOf ];
+          else
+            solvedp->solvedBoard[index].cards = 0;
           END_THREAD_TIMER(thid);
           continue;
         }
         else
         {
+          // The result goes straight to the caller.  It only 
+          // counts if the board was solved.
           START_THREAD_TIMER(thid);
           res = SolveBoard(
             bop->deals[index], 
             bop->target[index],
             bop->solutions[index], 
             bop->mode[index], 
-            &fut[index], 
+            &solvedp->solvedBoard[index], 
             thid);
           END_THREAD_TIMER(thid);
 
-          if (res == 1)
-            solvedp->solvedBoard[index] = fut[index];
-          else
+          if (! BatchResult(index, res, thid))
+          {
+            solvedp->solvedBoard[index].cards = 0;
             fail = res;
+          }
 
         }
       }
@@ -351,8 +554,10 @@ int SolveAllBoardsN(
   }
   else
   {
-    #pragma omp parallel default(none) shared(scheduler, bop, fut, solvedp, chunk, fail) private(st, index, thid, k, hint, res)
+    #pragma omp parallel default(none) shared(scheduler, bop, solvedp, chunk, fail) private(st, index, thid, k, hint, res, fut)
     {
+      RecordScope inner;
+
       #pragma omp while schedule(dynamic, chunk)
 
       while (1)
@@ -368,15 +573,26 @@ int SolveAllBoardsN(
         if (index == -1)
           break;
 
+        // The scores that are not solved in time stay at -1.
+        for (k = 0; k < chunk; k++)
+          solvedp->solvedBoard[index].score[k] = -1;
+
+        // Past the deadline the boards that are left are skipped.
+        if (BatchExpired())
+          continue;
+
         if (st.repeatOf != -1)
         {
           START_THREAD_TIMER(thid);
+          bool solved = BatchRepeat(index, st.repeatOf);
           for (k = 0; k < chunk; k++)
           {
             bop->deals[index].first = k;
 
-            solvedp->solvedBoard[index].score[k] =
-              solvedp->solvedBoard[ st.repeatOf ].score[k];
+            // The scores stay at -1 unless the head was solved.
+            if (solved)
+              solvedp->solvedBoard[index].score[k] =
+                solvedp->solvedBoard[ st.repeatOf ].score[k];
           }
           END_THREAD_TIMER(thid);
           continue;
@@ -390,35 +606,34 @@ int SolveAllBoardsN(
             bop->target[index],
             bop->solutions[index], 
             bop->mode[index], 
-            &fut[index], 
+            &fut, 
             thid);
 
         // SH: I'm making a terrible use of the fut structure here.
 
         if (res == 1)
-          solvedp->solvedBoard[index].score[0] = fut[index].score[0];
-        else
-          fail = res;
+          solvedp->solvedBoard[index].score[0] = fut.score[0];
 
-        for (k = 1; k < chunk; k++) 
+        for (k = 1; k < chunk && res == 1; k++) 
         {
-          hint = (k == 2 ? fut[index].score[0] : 
-                  13 - fut[index].score[0]);
+          hint = (k == 2 ? fut.score[0] : 
+                  13 - fut.score[0]);
 
           bop->deals[index].first = k; // Next declarer
 
           res = SolveSameBoard(
             bop->deals[index], 
-            &fut[index], 
+            &fut, 
             hint,
             thid);
 
           if (res == 1)
             solvedp->solvedBoard[index].score[k] = 
-              fut[index].score[0];
-          else
-            fail = res;
+              fut.score[0];
         }
+
+        if (! BatchResult(index, res, thid))
+          fail = res;
         END_THREAD_TIMER(thid);
       }
     }
@@ -427,15 +642,16 @@ int SolveAllBoardsN(
 
   END_BLOCK_TIMER;
 
-  if (fail != 1)
+  fail = BatchFinish(fail);
+  if (fail != 1 && fail != RETURN_DEADLINE)
     return fail;
 
   solvedp->noOfBoards = 0;
-  for (i = 0; i < MAXNOOFBOARDS; i++)
+  for (i = 0; i < bop->noOfBoards; i++)
     if (solvedp->solvedBoard[i].cards != 0)
       solvedp->noOfBoards++;
 
-  return 1;
+  return fail;
 }
 
 #endif
@@ -463,6 +679,119 @@ int STDCALL SolveBoardPBN(dealPBN dlpbn, int target,
 }
 
 
+int STDCALL SolveBoardSpeculative(
+  deal                  dl,
+  int                   target,
+  int                   solutions,
+  int                   mode,
+  futureTricks          * futp)
+{
+  // SolveBoard finds the optimum with one null-window search after
+  // the other.  Here each round runs the targets nearest the guess
+  // at the same time, one per thread, and the bounds they prove
+  // narrow down the next round.  A thread keeps its TT from round
+  // to round, as the deal is the same.
+
+  if (target != -1 || solutions == 3 || noOfThreads == 1)
+    return SolveBoard(dl, target, solutions, mode, futp, 0);
+
+  RecordScope rec;
+  if (rec.Active())
+    RecordSolveBoard(&dl, target, solutions, mode, 0);
+
+  int played = 0;
+  for (int k = 0; k <= 2; k++)
+    if (dl.currentTrickRank[k] != 0)
+      played++;
+
+  int handToPlay;
+  handToPlay = handId(dl.first, played);
+
+  int lower = 0, upper = 0;
+  for (int s = 0; s < DDS_SUITS; s++)
+    upper += counttable[dl.remainCards[handToPlay][s] >> 2];
+
+  int guess = 7 - (handToPlay & 0x1);
+  int nodes = 0, fail = 1;
+
+  futureTricks fut[MAXNOOFTHREADS], bestFut;
+  int probe[MAXNOOFTHREADS];
+
+  StopPonder();
+  ReleaseIdleThreads();
+
+  while (lower < upper)
+  {
+    // The targets in (lower, upper] in the order guess, guess+1, 
+    // guess-1, guess+2, ...
+    guess = Max(lower + 1, Min(upper, guess));
+    int n = 0;
+    for (int d = 0; n < noOfThreads && 
+        (guess + d <= upper || guess - d > lower); d++)
+    {
+      if (guess + d <= upper)
+        probe[n++] = guess + d;
+      if (d > 0 && n < noOfThreads && guess - d > lower)
+        probe[n++] = guess - d;
+    }
+
+#if defined (_OPENMP) && !defined(DDS_THREADS_SINGLE)
+    if (omp_get_dynamic())
+      omp_set_dynamic(0);
+    omp_set_num_threads(n);
+#endif
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < n; k++)
+    {
+      RecordScope inner;
+      int res = SolveBoard(dl, probe[k], 1, mode, &fut[k], k);
+      if (res != 1)
+        fail = res;
+    }
+
+    if (fail != 1)
+      return fail;
+
+    // mode == 0 and only one card to play.
+    if (fut[0].score[0] == -2)
+    {
+      * futp = fut[0];
+      return 1;
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+      nodes += fut[k].nodes;
+      if (fut[k].cards > 0 && fut[k].score[0] == probe[k])
+      {
+        if (probe[k] > lower)
+        {
+          lower   = probe[k];
+          bestFut = fut[k];
+        }
+      }
+      else
+        upper = Min(upper, probe[k] - 1);
+    }
+  }
+
+  if (lower > 0 && solutions == 1)
+    * futp = bestFut;
+  else
+  {
+    // The cards with a score of 0, or all the cards that make.
+    int res = SolveBoard(dl, lower, solutions, mode, futp, 0);
+    if (res != 1)
+      return res;
+    nodes += futp->nodes;
+  }
+
+  futp->nodes = nodes;
+  return 1;
+}
+
+
 int STDCALL SolveAllBoards(boardsPBN *bop, solvedBoards *solvedp) {
   boards bo;
   int k, i, res;
@@ -485,6 +814,7 @@ int STDCALL SolveAllBoards(boardsPBN *bop, solvedBoards *solvedp) {
       return RETURN_PBN_FAULT;
   }
 
+  StartBatchDeadline();
   res=SolveAllBoardsN(&bo, solvedp, 1, 0);
 
   return res;
@@ -515,6 +845,7 @@ int STDCALL SolveAllChunksPBN(boardsPBN *bop, solvedBoards *solvedp, int chunkSi
       return RETURN_PBN_FAULT;
   }
 
+  StartBatchDeadline();
   res = SolveAllBoardsN(&bo, solvedp, chunkSize, 0);
   return res;
 }
@@ -534,6 +865,7 @@ int STDCALL SolveAllChunksBin(boards *bop, solvedBoards *solvedp, int chunkSize)
   if (chunkSize < 1)
     return RETURN_CHUNK_SIZE;
 
+  StartBatchDeadline();
   res = SolveAllBoardsN(bop, solvedp, chunkSize, 0);
   return res;
 }
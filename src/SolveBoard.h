@@ -14,3 +14,37 @@ int SolveAllBoardsN(
   int                   chunkSize,
   int                   source); // 0 source, 1 calc
 
+
+// Batch deadline and board status, see SetBatchDeadline().
+
+void StartBatchDeadline();
+
+void BatchBegin(
+  int                   noOfBoards);
+
+bool BatchExpired();
+
+bool BatchResult(
+  int                   index,
+  int                   res,
+  int                   thrId);
+
+bool BatchRepeat(
+  int                   index,
+  int                   head);
+
+int BatchFinish(
+  int                   res);
+
+void BatchGroup(
+  int                   size);
+
+
+// The position after the card (suit, rank) of the hand to play.
+// The card must be held.
+
+void DealAfterCard(
+  const deal            * dl,
+  int                   suit,
+  int                   rank,
+  deal                  * child);
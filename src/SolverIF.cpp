@@ -7,6 +7,7 @@
    See LICENSE and README.
 */
 
+#include <atomic>
 #include <stdexcept>
 
 #include "dds.h"
@@ -16,6 +17,7 @@
 #include "ABsearch.h"
 #include "Stats.h"
 #include "SolverIF.h"
+#include "Recorder.h"
 
 
 int BoardRangeChecks(
@@ -52,9 +54,30 @@ void PrintDeal(
   FILE                  * fp, 
   unsigned short        ranks[][DDS_SUITS]);
 
+int SearchExpired(
+  localVarType          * thrp,
+  int                   lower,
+  int                   upper);
+
+int TricksLeft(
+  localVarType          * thrp);
+
+void StartWatch(
+  localVarType          * thrp);
+
+bool ProgressStop(
+  localVarType          * thrp,
+  long long             now);
+
+long long MicroTime();
+
 
 extern int noOfThreads;  
 
+// Set by SetProgressCallback() while other threads may search.
+std::atomic<progressCallback> progressFunc(nullptr);
+std::atomic<int>        progressInterval(1000);  // Milliseconds
+
 
 bool (* AB_ptr_list[DDS_HANDS])( 
   pos                   * posPoint, 
@@ -86,6 +109,7 @@ int STDCALL SolveBoard(
   int                   thrId)
 {
   localVarType * thrp = &localVar[thrId];
+  RecordScope rec;
 
   // ----------------------------------------------------------
   // Formal parameter checks.
@@ -95,6 +119,17 @@ int STDCALL SolveBoard(
   if (ret != RETURN_NO_FAULT)
     return ret;
 
+  if (rec.Active())
+    RecordSolveBoard(&dl, target, solutions, mode, thrId);
+
+  ThreadBusy busy(thrp);
+  if (! ActivateThread(thrp))
+    return RETURN_UNKNOWN_FAULT;
+
+  // So that a program calling SolveBoard on its own also gets
+  // the memory back from threads that it no longer uses.
+  ReleaseIdleThreads();
+
   // ----------------------------------------------------------
   // Count and classify deal.
   // ----------------------------------------------------------
@@ -154,10 +189,13 @@ int STDCALL SolveBoard(
   int handRelFirst = (48 - iniDepth) % 4;
   int handToPlay   = handId(dl.first, handRelFirst);
   thrp->trickNodes = 0;
+  StartWatch(thrp);
 
   thrp->lookAheadPos.handRelFirst = handRelFirst;
   thrp->lookAheadPos.first[iniDepth] = dl.first;
   thrp->lookAheadPos.tricksMAX = 0;
+  thrp->horizonDepth = (thrp->horizon > 0 ?
+    iniDepth + handRelFirst - 4 * thrp->horizon : 0);
 
   moveType mv = {0, 0, 0, 0};
 
@@ -202,18 +240,25 @@ int STDCALL SolveBoard(
   // More detailed initialization.
   // ----------------------------------------------------------
 
-  if ((mode != 2) &&
-      (((newDeal) && (! similarDeal)) || 
-         newTrump  ||
-        (thrp->nodes > SIMILARMAXWINNODES)))
+  if (mode != 2)
   {
-    thrp->transTable.ResetMemory();
+    // The tables of the other strains are only kept for the same
+    // or a similar deal.
+    if ((newDeal) && (! similarDeal))
+      ForgetStrainTables(thrp);
+
+    // The entries of a horizon search only hold for its own
+    // horizon and frontier, so it starts from an empty table.
+    SelectStrainTable(thrp, dl.trump,
+      (thrp->horizon > 0) ||
+      ((! newTrump) && (thrp->nodes > SIMILARMAXWINNODES)));
   }
 
   if (newDeal)
   {
     SetDeal(thrp);
-    SetDealTables(thrp);
+    if (! SetDealTables(thrp, thrId))
+      return RETURN_UNKNOWN_FAULT;
   }
   else if (thrp->analysisFlag)
   {
@@ -232,6 +277,17 @@ int STDCALL SolveBoard(
     thrp->nodeTypeStore[2] = MINNODE; thrp->nodeTypeStore[3] = MAXNODE;
   }
 
+  // Before the cards of the current trick are made, as they
+  // need the trump suit and the leader of this deal.
+  thrp->moves.Init(
+    trick,
+    handRelFirst,
+    dl.currentTrickRank,
+    dl.currentTrickSuit,
+    thrp->lookAheadPos.rankInSuit,
+    thrp->trump,
+    thrp->lookAheadPos.first[iniDepth]);
+
   for (int k = 0; k < handRelFirst; k++)
   {
     mv.rank     = dl.currentTrickRank[k];
@@ -253,15 +309,6 @@ int STDCALL SolveBoard(
   thrp->nodes = 0;
 #endif
 
-  thrp->moves.Init(
-    trick,
-    handRelFirst,
-    dl.currentTrickRank,
-    dl.currentTrickSuit,
-    thrp->lookAheadPos.rankInSuit,
-    thrp->trump,
-    thrp->lookAheadPos.first[iniDepth]);
-
   if (handRelFirst == 0)
     thrp->moves.MoveGen0( 
       trick,
@@ -308,11 +355,20 @@ int STDCALL SolveBoard(
     int lowerbound = 0;
     futp->cards    = noMoves;
 
+    // With the best score known, one search finds the best card.
+    if (thrp->scoreKnown)
+    {
+      upperbound = thrp->knownScore;
+      guess      = Max(upperbound, 1);
+    }
+
     for (int mno = 0; mno < noMoves; mno++)
     {
       do
       {
         ResetBestMoves(thrp);
+        thrp->lowerBound = lowerbound;
+        thrp->upperBound = upperbound;
 
         TIMER_START(TIMER_AB + iniDepth);
         thrp->val = (* AB_ptr_list[handRelFirst])(
@@ -326,6 +382,17 @@ int STDCALL SolveBoard(
         DumpTopLevel(thrp, guess, lowerbound, upperbound, 1);
 #endif
 
+        if (thrp->expired)
+        {
+          // The cards so far are kept.  After the first one the
+          // best score is known.
+          futp->cards = mno;
+          ret = (mno == 0 ?
+            SearchExpired(thrp, lowerbound, upperbound) :
+            SearchExpired(thrp, futp->score[0], futp->score[0]));
+          goto SOLVER_STATS;
+        }
+
         if (thrp->val)
         {
           mv = thrp->bestMove[iniDepth];
@@ -407,6 +474,8 @@ int STDCALL SolveBoard(
     do
     {
       ResetBestMoves(thrp);
+      thrp->lowerBound = lowerbound;
+      thrp->upperBound = upperbound;
 
       TIMER_START(TIMER_AB + iniDepth);
       thrp->val = (* AB_ptr_list[handRelFirst])(&thrp->lookAheadPos,
@@ -419,6 +488,13 @@ int STDCALL SolveBoard(
     DumpTopLevel(thrp, guess, lowerbound, upperbound, 1);
 #endif
 
+      if (thrp->expired)
+      {
+        futp->cards = 0;
+        ret = SearchExpired(thrp, lowerbound, upperbound);
+        goto SOLVER_STATS;
+      }
+
       if (thrp->val)
       {
         mv = thrp->bestMove[iniDepth];
@@ -485,6 +561,13 @@ int STDCALL SolveBoard(
     DumpTopLevel(thrp, target, -1, -1, 0);
 #endif
 
+    if (thrp->expired)
+    {
+      futp->cards = 0;
+      ret = SearchExpired(thrp, 0, 13);
+      goto SOLVER_STATS;
+    }
+
     if (! thrp->val)
     {
       // No move.  If target was 1, then we are sure that in
@@ -518,6 +601,9 @@ int STDCALL SolveBoard(
   forb = 1;
   ind  = 1;
 
+  thrp->lowerBound = futp->score[0];
+  thrp->upperBound = (target == -1 ? futp->score[0] : 13);
+
   while (ind < noMoves)
   {
     // Moves up to and including bestMove are now forbidden.
@@ -550,6 +636,15 @@ int STDCALL SolveBoard(
     DumpTopLevel(thrp, target, -1, -1, 2);
 #endif
 
+    if (thrp->expired)
+    {
+      // The cards so far are kept.  With target == -1 they have
+      // the best score, and otherwise at least the target.
+      ret = SearchExpired(thrp, futp->score[0],
+        (target == -1 ? futp->score[0] : 13));
+      goto SOLVER_STATS;
+    }
+
     if (! thrp->val)
       break;
 
@@ -575,11 +670,12 @@ SOLVER_STATS:
 #endif
 
 #ifdef DDS_TT_STATS
-  // thrp->transTable.PrintAllSuits();
-  // thrp->transTable.PrintEntries(10, 0);
-  thrp->transTable.PrintSummarySuitStats();
-  thrp->transTable.PrintSummaryEntryStats();
-  // thrp->transTable.PrintPageSummary();
+  // thrp->transTable->PrintAllSuits();
+  // thrp->transTable->PrintEntries(10, 0);
+  thrp->transTable->PrintSummarySuitStats();
+  thrp->transTable->PrintSummaryEntryStats();
+  // thrp->transTable->PrintPageSummary();
+  thrp->transTable->PrintColdSummary();
 #endif
 
 #ifdef DDS_MOVES
@@ -592,8 +688,8 @@ SOLVER_STATS:
 
 SOLVER_DONE:
 
-  thrp->memUsed = thrp->transTable.MemoryInUse() +
-    ThreadMemoryUsed();
+  TrimStrainTables(thrp, 0.);
+  thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
 
   futp->nodes = thrp->trickNodes;
 
@@ -601,6 +697,160 @@ SOLVER_DONE:
   _CrtDumpMemoryLeaks();
 #endif
 
+  return ret;
+}
+
+
+int SearchExpired(
+  localVarType          * thrp,
+  int                   lower,
+  int                   upper)
+{
+  // The search ran past the batch deadline, or it was cancelled.
+  // The bounds are kept for the caller, no more than the tricks
+  // that are left.
+
+  thrp->lowerBound = lower;
+  thrp->upperBound = Min(upper, TricksLeft(thrp));
+
+  DiscardStrainTable(thrp);
+  return (thrp->cancelled ? RETURN_CANCELLED : RETURN_DEADLINE);
+}
+
+
+int TricksLeft(
+  localVarType          * thrp)
+{
+  int handRelFirst = (48 - thrp->iniDepth) % 4;
+  return (thrp->iniDepth + handRelFirst) / 4 + 1;
+}
+
+
+void StartWatch(
+  localVarType          * thrp)
+{
+  thrp->expired    = false;
+  thrp->cancelled  = false;
+  thrp->lowerBound = 0;
+  thrp->upperBound = 13;
+
+  if (progressFunc.load() == nullptr)
+    thrp->nextReport = 0;
+  else
+  {
+    thrp->startTime  = MicroTime();
+    thrp->nextReport = thrp->startTime + 1000LL * progressInterval.load();
+  }
+
+  thrp->watched = (thrp->deadline > 0 || thrp->nextReport > 0 ||
+    thrp->stopFlag != nullptr);
+}
+
+
+bool ProgressStop(
+  localVarType          * thrp,
+  long long             now)
+{
+  // Called from the search when a report is due.  The callback may
+  // be taken away at any time, so it is loaded once, and the call
+  // below may still go to the callback that was just cleared.
+
+  progressCallback func = progressFunc.load();
+  thrp->nextReport = now + 1000LL * progressInterval.load();
+  if (func == nullptr)
+    return false;
+
+  solveProgress prog;
+  prog.thrId       = static_cast<int>(thrp - localVar);
+  prog.nodes       = thrp->trickNodes;
+  prog.lowerBound  = thrp->lowerBound;
+  prog.upperBound  = Min(thrp->upperBound, TricksLeft(thrp));
+  prog.elapsedTime = static_cast<int>((now - thrp->startTime) / 1000);
+  prog.memoryUsed  = TablesMemoryUsed(thrp);
+  prog.memoryMax   = thrp->memMax;
+
+  if ((* func)(&prog) == 0)
+    return false;
+
+  thrp->cancelled = true;
+  return true;
+}
+
+
+void STDCALL SetProgressCallback(
+  progressCallback      callback,
+  int                   milliSeconds)
+{
+  progressInterval.store(Max(milliSeconds, 1));
+  progressFunc.store(callback);
+}
+
+
+int STDCALL SolveBoardHorizon(
+  deal                  dl,
+  int                   horizon,
+  futureTricks          * futp,
+  int                   * lowerp,
+  int                   * upperp,
+  int                   thrId)
+{
+  // Three searches that stop after horizon tricks.  At the frontier
+  // the first one gives the side on lead only its quick tricks, and
+  // the second one all the tricks that are left, so that the two
+  // bound the score.  The third one gives it the middle, and finds
+  // the estimate and the card.
+
+  if (thrId < 0 || thrId >= noOfThreads)
+    return RETURN_THREAD_INDEX;
+
+  // The searches are not recorded, as they do not replay as such.
+  RecordScope rec;
+
+  localVarType * thrp = &localVar[thrId];
+  thrp->horizon = Max(horizon, 0);
+
+  const int modes[3] = 
+    { DDS_HORIZON_LOWER, DDS_HORIZON_UPPER, DDS_HORIZON_ESTIMATE };
+  futureTricks fut[3];
+  int nodes = 0;
+
+  for (int m = 0; m < 3; m++)
+  {
+    thrp->horizonMode = modes[m];
+    int ret = SolveBoard(dl, -1, 1, 1, &fut[m], thrId);
+    if (ret != RETURN_NO_FAULT)
+    {
+      thrp->horizon = 0;
+      return ret;
+    }
+    nodes += fut[m].nodes;
+
+    // The horizon is at or beyond the end, so the search was exact.
+    if (m == 0 && thrp->horizonDepth <= 0)
+    {
+      fut[1] = fut[0];
+      fut[2] = fut[0];
+      break;
+    }
+
+    if (m == 1 && fut[0].score[0] == fut[1].score[0])
+    {
+      // The first card makes the score for sure.
+      fut[2] = fut[0];
+      break;
+    }
+  }
+
+  // Its entries must not be found by an exact search.
+  if (thrp->horizonDepth > 0)
+    DiscardStrainTable(thrp);
+  thrp->horizon = 0;
+
+  * lowerp = fut[0].score[0];
+  * upperp = fut[1].score[0];
+  * futp   = fut[2];
+  futp->score[0] = Max(* lowerp, Min(* upperp, futp->score[0]));
+  futp->nodes = nodes;
   return RETURN_NO_FAULT;
 }
 
@@ -619,10 +869,12 @@ int SolveSameBoard(
   // The function only needs to return fut.score[0].
 
   localVarType * thrp = &localVar[thrId];
+  ThreadBusy busy(thrp);
 
   int iniDepth     = thrp->iniDepth;
   int trick        = (iniDepth + 3) >> 2;
   thrp->trickNodes = 0;
+  StartWatch(thrp);
 
   thrp->lookAheadPos.first[iniDepth] = dl.first;
 
@@ -655,6 +907,8 @@ int SolveSameBoard(
   do
   {
     ResetBestMoves(thrp);
+    thrp->lowerBound = lowerbound;
+    thrp->upperBound = upperbound;
 
     TIMER_START(TIMER_AB + iniDepth);
     thrp->val = ABsearch(
@@ -668,6 +922,9 @@ int SolveSameBoard(
     DumpTopLevel(thrp, guess, lowerbound, upperbound, 1);
 #endif
 
+    if (thrp->expired)
+      return SearchExpired(thrp, lowerbound, upperbound);
+
     if (thrp->val)
       lowerbound = guess++;
     else
@@ -678,16 +935,15 @@ int SolveSameBoard(
   futp->cards    = 1;
   futp->score[0] = lowerbound;
 
-  thrp->memUsed = thrp->transTable.MemoryInUse() +
-    ThreadMemoryUsed();
+  thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
 
 #ifdef DDS_TIMING
   thrp->timer.PrintStats();
 #endif
 
 #ifdef DDS_TT_STATS
-  thrp->transTable.PrintSummarySuitStats();
-  thrp->transTable.PrintSummaryEntryStats();
+  thrp->transTable->PrintSummarySuitStats();
+  thrp->transTable->PrintSummaryEntryStats();
 #endif
 
 #ifdef DDS_MOVES
@@ -724,6 +980,7 @@ int AnalyseLaterBoard(
   // The function only needs to return fut.score[0].
 
   localVarType * thrp = &localVar[thrId];
+  ThreadBusy busy(thrp);
 
   int iniDepth         = --thrp->iniDepth;
   int cardCount        = iniDepth + 4;
@@ -731,6 +988,7 @@ int AnalyseLaterBoard(
   int handRelFirst     = (48 - iniDepth) % 4;
   thrp->trickNodes     = 0;
   thrp->analysisFlag   = true;
+  StartWatch(thrp);
   int handToPlay       = handId(leadHand, handRelFirst);
 
   if (handToPlay == 0 || handToPlay == 2)
@@ -803,6 +1061,8 @@ int AnalyseLaterBoard(
   do
   {
     ResetBestMoves(thrp);
+    thrp->lowerBound = lowerbound;
+    thrp->upperBound = upperbound;
 
     TIMER_START(TIMER_AB + iniDepth);
     thrp->val = (* AB_ptr_trace_list[handRelFirst])(
@@ -816,6 +1076,9 @@ int AnalyseLaterBoard(
     DumpTopLevel(thrp, guess, lowerbound, upperbound, 1);
 #endif
 
+    if (thrp->expired)
+      return SearchExpired(thrp, lowerbound, upperbound);
+
     if (thrp->val)
       lowerbound = guess++;
     else
@@ -827,16 +1090,15 @@ int AnalyseLaterBoard(
   futp->score[0] = lowerbound;
   futp->nodes    = thrp->trickNodes;
 
-  thrp->memUsed = thrp->transTable.MemoryInUse() +
-    ThreadMemoryUsed();
+  thrp->memUsed = TablesMemoryUsed(thrp) + ThreadMemoryUsed();
 
 #ifdef DDS_TIMING
   thrp->timer.PrintStats();
 #endif
 
 #ifdef DDS_TT_STATS
-  thrp->transTable.PrintSummarySuitStats();
-  thrp->transTable.PrintSummaryEntryStats();
+  thrp->transTable->PrintSummarySuitStats();
+  thrp->transTable->PrintSummaryEntryStats();
 #endif
 
 #ifdef DDS_MOVES
@@ -1082,7 +1344,7 @@ void LastTrickWinner(
       if (thrp->suit[hp][s] != 0)
       {
         lastTrickSuit[hp] = s;
-        lastTrickRank[hp] = thrp->suit[hp][s];
+        lastTrickRank[hp] = highestRank[thrp->suit[hp][s]];
         break;
       }
     }
@@ -1125,8 +1387,8 @@ void LastTrickWinner(
     }
   }
 
-  * leadRank     = lastTrickRank[handRelFirst];
-  * leadSuit     = lastTrickSuit[handRelFirst];
+  * leadRank     = lastTrickRank[handToPlay];
+  * leadSuit     = lastTrickSuit[handToPlay];
   * leadSideWins = ((handToPlay == maxHand ||
                      partner[handToPlay] == maxHand) ? 1 : 0);
 }
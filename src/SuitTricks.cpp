@@ -0,0 +1,271 @@
+/* 
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund / 
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#include "dds.h"
+#include "SuitTricks.h"
+
+/*
+   A distribution of n cards is encoded with two bits per card,
+   the highest card in the most significant position.  The two
+   bits are the owner of the card relative to the hand on lead,
+   so 0 is the leader, 1 LHO, 2 partner and 3 RHO.  A change of
+   lead to partner is then simply an XOR of every owner with 2.
+
+   Each entry is one byte.  The low nibble is the number of 
+   tricks, and the high nibble is the number of top cards that 
+   the result depends on, in the same sense as leastWin in the 
+   transposition table.  The table is built once from the 
+   smaller distributions upwards.
+*/
+
+#define ST_VOID         -1
+
+struct stEntryType
+{
+  int                   tricks;
+  int                   leastWin;
+};
+
+int stOffset[ST_MAXCARDS + 2];
+
+unsigned char * stTable = nullptr;
+
+
+stEntryType CalcEntry(
+  int                   n,
+  int                   own[]);
+
+stEntryType TrickValue(
+  int                   n,
+  int                   own[],
+  int                   played[]);
+
+
+void InitSuitTricks()
+{
+  if (stTable)
+    return;
+
+  stOffset[0] = 0;
+  for (int n = 0; n <= ST_MAXCARDS; n++)
+    stOffset[n+1] = stOffset[n] + (1 << (2*n));
+
+  stTable = static_cast<unsigned char *>
+    (calloc(static_cast<size_t>(stOffset[ST_MAXCARDS + 1]), 1));
+  if (! stTable)
+    return;
+
+  int own[ST_MAXCARDS];
+  for (int n = 1; n <= ST_MAXCARDS; n++)
+  {
+    for (int idx = 0; idx < (1 << (2*n)); idx++)
+    {
+      for (int i = 0; i < n; i++)
+        own[i] = (idx >> (2 * (n-1-i))) & 3;
+
+      stEntryType entry = CalcEntry(n, own);
+      stTable[stOffset[n] + idx] = static_cast<unsigned char>
+        ((entry.leastWin << 4) | entry.tricks);
+    }
+  }
+}
+
+
+void FreeSuitTricks()
+{
+  free(stTable);
+  stTable = nullptr;
+}
+
+
+stEntryType CalcEntry(
+  int                   n,
+  int                   own[])
+{
+  // Cards held by the same hand with no other card in between
+  // are equivalent, so only the top card of each run is tried.
+  // The search is a plain minimax over one trick, with the
+  // tricks that follow looked up in the smaller tables.
+  // As in the main search, the cards that matter are those of 
+  // the best move for the leader's side, and those of all the
+  // replies by the opponents.
+
+  int played[DDS_HANDS];
+  stEntryType best = {0, 0};
+
+  // Each trick uses up a card from both hands of the leader's 
+  // side, unless one of them is void.
+  int count[DDS_HANDS] = {0, 0, 0, 0};
+  for (int i = 0; i < n; i++)
+    count[own[i]]++;
+  int maxTricks = Max(count[0], count[2]);
+
+  for (int a = 0; a < n && best.tricks < maxTricks; a++)
+  {
+    if (own[a] != 0 || (a > 0 && own[a-1] == 0))
+      continue;
+    played[0] = a;
+
+    stEntryType worstB = {14, 0};
+    bool voidB = (count[1] == 0);
+
+    for (int b = (voidB ? ST_VOID : 0); b < n; b++)
+    {
+      if (b != ST_VOID &&
+         (own[b] != 1 || (b > 0 && own[b-1] == 1)))
+        continue;
+      played[1] = b;
+
+      stEntryType bestC = {-1, 0};
+      bool voidC = (count[2] == 0);
+
+      for (int c = (voidC ? ST_VOID : 0); c < n; c++)
+      {
+        if (c != ST_VOID &&
+           (own[c] != 2 || (c > 0 && own[c-1] == 2)))
+          continue;
+        played[2] = c;
+
+        stEntryType worstD = {14, 0};
+        bool voidD = (count[3] == 0);
+
+        for (int d = (voidD ? ST_VOID : 0); d < n; d++)
+        {
+          if (d != ST_VOID &&
+             (own[d] != 3 || (d > 0 && own[d-1] == 3)))
+            continue;
+          played[3] = d;
+
+          stEntryType v = TrickValue(n, own, played);
+          if (v.tricks < worstD.tricks)
+            worstD.tricks = v.tricks;
+          worstD.leastWin = Max(worstD.leastWin, v.leastWin);
+          if (worstD.tricks == 0 || voidD)
+            break;
+        }
+
+        if (worstD.tricks > bestC.tricks)
+          bestC = worstD;
+        if (bestC.tricks >= worstB.tricks || voidC)
+          break;
+      }
+
+      if (bestC.tricks < worstB.tricks)
+        worstB.tricks = bestC.tricks;
+      worstB.leastWin = Max(worstB.leastWin, bestC.leastWin);
+      if (worstB.tricks <= best.tricks || voidB)
+        break;
+    }
+
+    if (worstB.tricks > best.tricks)
+      best = worstB;
+  }
+
+  if (best.tricks == 0)
+    best.leastWin = 0;
+  return best;
+}
+
+
+stEntryType TrickValue(
+  int                   n,
+  int                   own[],
+  int                   played[])
+{
+  // The highest card is the one with the lowest index.
+  stEntryType res = {0, 0};
+  int winIndex = n, count = 0;
+  for (int h = 0; h < DDS_HANDS; h++)
+  {
+    if (played[h] == ST_VOID)
+      continue;
+    count++;
+    if (played[h] < winIndex)
+      winIndex = played[h];
+  }
+
+  int w = own[winIndex];
+  if (w & 1)
+    return res;
+
+  // The winning card only matters if it beat another card.
+  res.tricks = 1;
+  if (count > 1)
+    res.leastWin = winIndex + 1;
+
+  int m = 0, idx = 0, parentIndex[ST_MAXCARDS];
+  for (int i = 0; i < n; i++)
+  {
+    if (i == played[0] || i == played[1] ||
+        i == played[2] || i == played[3])
+      continue;
+    idx = (idx << 2) | (own[i] ^ w);
+    parentIndex[m++] = i;
+  }
+
+  if (m > 0)
+  {
+    int e = stTable[stOffset[m] + idx];
+    int lw = e >> 4;
+    res.tricks += (e & 0xf);
+    if (lw > 0)
+      res.leastWin = Max(res.leastWin, parentIndex[lw-1] + 1);
+  }
+  return res;
+}
+
+
+int SuitTricks(
+  pos                   * posPoint,
+  int                   hand,
+  int                   suit,
+  unsigned short        * winMask)
+{
+  int aggr = posPoint->aggr[suit];
+  int n = counttable[aggr];
+  *winMask = 0;
+  if (n == 0 || n > ST_MAXCARDS || stTable == nullptr)
+    return 0;
+
+  unsigned short (* ris)[DDS_SUITS] = posPoint->rankInSuit;
+  int holdLead = ris[hand][suit];
+  int holdLho  = ris[lho[hand]][suit];
+  int holdPard = ris[partner[hand]][suit];
+
+  int idx = 0;
+  for (int r = 14; r >= 2; r--)
+  {
+    int bit = bitMapRank[r];
+    if ((aggr & bit) == 0)
+      continue;
+
+    if (holdLead & bit)
+      idx <<= 2;
+    else if (holdLho & bit)
+      idx = (idx << 2) | 1;
+    else if (holdPard & bit)
+      idx = (idx << 2) | 2;
+    else
+      idx = (idx << 2) | 3;
+  }
+
+  int e = stTable[stOffset[n] + idx];
+  *winMask = winRanks[aggr][e >> 4];
+  return e & 0xf;
+}
+
+
+double SuitTricksMemoryUsed()
+{
+  double memUsed =
+    stOffset[ST_MAXCARDS + 1] / static_cast<double>(1024.);
+
+  return memUsed;
+}
@@ -0,0 +1,40 @@
+/* 
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund / 
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#ifndef DDS_SUITTRICKSH
+#define DDS_SUITTRICKSH
+
+/*
+   The single-suit table holds, for every distribution of up to
+   ST_MAXCARDS cards of one suit (after relative-rank compression)
+   among the four hands, the number of tricks in a row that the
+   side on lead can take in that suit alone before the opponents
+   win a trick.  The hand on lead is always relative hand 0.
+
+   SuitTricks() looks up the suit from the point of view of the
+   hand on lead, and winMask returns the cards that the result
+   depends on.
+*/
+
+#define ST_MAXCARDS     9
+
+void InitSuitTricks();
+
+void FreeSuitTricks();
+
+int SuitTricks(
+  struct pos            * posPoint,
+  int                   hand,
+  int                   suit,
+  unsigned short        * winMask);
+
+double SuitTricksMemoryUsed();
+
+#endif
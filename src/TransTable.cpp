@@ -104,6 +104,7 @@ TransTable::TransTable()
   }
 
   poolp        = nullptr;
+  aggr         = nullptr;
   pagesDefault = NUM_PAGES_DEFAULT;
   pagesMaximum = NUM_PAGES_MAXIMUM;
   pagesCurrent = 0;
@@ -116,14 +117,27 @@ TransTable::TransTable()
 
   timestamp    = 0;
 
-  pageStats.numResets   = 0;
-  pageStats.numCallocs  = 0;
-  pageStats.numFrees    = 0;
-  pageStats.numHarvests = 0;
-  pageStats.lastCurrent = 0;
+  pageStats.numResets     = 0;
+  pageStats.numFullResets = 0;
+  pageStats.numCallocs    = 0;
+  pageStats.numFrees      = 0;
+  pageStats.numHarvests   = 0;
+  pageStats.lastCurrent   = 0;
 
   TTInUse = 0;
 
+  coldBuf      = nullptr;
+  coldHead     = nullptr;
+  coldSize     = 0;
+  coldWritePos = 0;
+
+  coldStats.numStores        = 0;
+  coldStats.numStoredEntries = 0;
+  coldStats.numStoredBytes   = 0;
+  coldStats.numLookups       = 0;
+  coldStats.numLoads         = 0;
+  coldStats.numLoadedEntries = 0;
+
   strcpy(fname, "");
   fp = stdout;
 }
@@ -182,7 +196,9 @@ void TransTable::SetConstants()
 }
 
 
-void TransTable::Init(int handLookup[][15])
+void TransTable::MakeAggr(
+  int                   handLookup[][15],
+  aggrType              aggrList[])
 {
   // This is very similar to SetConstants, except that it
   // happens with actual cards.  It also makes sense to
@@ -195,11 +211,11 @@ void TransTable::Init(int handLookup[][15])
 
   for (int s = 0; s < DDS_SUITS; s++)
   {
-    aggr[0].aggrRanks[s] = 0;
-    aggr[0].aggrBytes[s][0] = 0;
-    aggr[0].aggrBytes[s][1] = 0;
-    aggr[0].aggrBytes[s][2] = 0;
-    aggr[0].aggrBytes[s][3] = 0;
+    aggrList[0].aggrRanks[s] = 0;
+    aggrList[0].aggrBytes[s][0] = 0;
+    aggrList[0].aggrBytes[s][1] = 0;
+    aggrList[0].aggrBytes[s][2] = 0;
+    aggrList[0].aggrBytes[s][3] = 0;
   }
 
   for (unsigned ind = 1; ind < 8192; ind++)
@@ -211,8 +227,8 @@ void TransTable::Init(int handLookup[][15])
       topBitNo++;
     }
 
-    aggr[ind] = aggr[ind ^ topBitRank];
-    ap = &aggr[ind];
+    aggrList[ind] = aggrList[ind ^ topBitRank];
+    ap = &aggrList[ind];
 
     for (int s = 0; s < DDS_SUITS; s++)
     {
@@ -243,6 +259,13 @@ void TransTable::Init(int handLookup[][15])
 }
 
 
+void TransTable::SetAggr(
+  aggrType              * aggrList)
+{
+  aggr = aggrList;
+}
+
+
 void TransTable::SetMemoryDefault(int megabytes)
 {
   double blockMem = BLOCKS_PER_PAGE * sizeof(winBlockType) /
@@ -261,6 +284,50 @@ void TransTable::SetMemoryMaximum(int megabytes)
 }
 
 
+void TransTable::SetMemoryCold(int megabytes)
+{
+  // The memory itself is only allocated once it is needed.
+  long long bytes = 1024 * 1024 * static_cast<long long>(megabytes);
+  if (bytes == coldSize)
+    return;
+
+  TransTable::ReleaseCold();
+  coldSize = bytes;
+}
+
+
+bool TransTable::MakeCold()
+{
+  if (coldSize == 0)
+    return false;
+
+  coldBuf = static_cast<unsigned char *>
+    (malloc(static_cast<size_t>(coldSize)));
+  coldHead = static_cast<long long *>
+    (malloc(COLD_HASH_SIZE * sizeof(long long)));
+
+  if (coldBuf == nullptr || coldHead == nullptr)
+  {
+    // Not fatal, we just do without the cold tier.
+    TransTable::ReleaseCold();
+    coldSize = 0;
+    return false;
+  }
+
+  TransTable::ColdReset();
+  return true;
+}
+
+
+void TransTable::ReleaseCold()
+{
+  free(coldBuf);
+  free(coldHead);
+  coldBuf  = nullptr;
+  coldHead = nullptr;
+}
+
+
 void TransTable::MakeTT()
 {
   if (! TTInUse)
@@ -276,6 +343,10 @@ void TransTable::MakeTT()
       
         if (TTroot[t][h] == nullptr)
           exit(1);
+
+        // The new memory is cleared in full.
+        for (int w = 0; w < 4; w++)
+          rootUsed[t][h][w] = ~0ULL;
       }
     }
   }
@@ -286,15 +357,29 @@ void TransTable::MakeTT()
 
 void TransTable::InitTT()
 {
+  // Each entry is 520 bytes, so clearing all of them costs a cache
+  // miss each.  Only the ones that were used are cleared.
+
   for (int c = 0; c < TT_TRICKS; c++)
   {
     for (int h = 0; h < DDS_HANDS; h++)
     {
-      for (int i = 0; i < 256; i++)
+      for (int w = 0; w < 4; w++)
       {
-        TTroot[c][h][i].nextNo      = 0;
-        TTroot[c][h][i].nextWriteNo = 0;
+        unsigned long long used = rootUsed[c][h][w];
+        if (used == 0)
+          continue;
+
+        for (int b = 0; b < 64; b++)
+        {
+          if ((used & (1ULL << b)) == 0)
+            continue;
 
+          distHashType * dp = &TTroot[c][h][64 * w + b];
+          dp->nextNo      = 0;
+          dp->nextWriteNo = 0;
+        }
+        rootUsed[c][h][w] = 0;
       }
       lastBlockSeen[c][h] = nullptr;
     }
@@ -316,12 +401,31 @@ void TransTable::ReleaseTT()
         continue;
       
       free(TTroot[t][h]);
+      TTroot[t][h] = nullptr;
     }
   }
 }
 
 
 void TransTable::ResetMemory()
+{
+  // Called for a new deal, so the cold tier is no longer valid.
+  TransTable::ColdReset();
+  TransTable::ResetPages();
+}
+
+
+void TransTable::ResetWhenFull()
+{
+  // Out of memory in the middle of a search.  The blocks are
+  // kept in the cold tier if there is one.
+  pageStats.numFullResets++;
+  TransTable::ColdStoreAll();
+  TransTable::ResetPages();
+}
+
+
+void TransTable::ResetPages()
 {
   if (poolp == nullptr)
     return;
@@ -380,11 +484,21 @@ void TransTable::ReturnAllMemory()
 
   pagesCurrent = 0;
 
-  pageStats.numResets   = 0;
-  pageStats.numCallocs  = 0;
-  pageStats.numFrees    = 0;
-  pageStats.numHarvests = 0;
-  pageStats.lastCurrent = 0;
+  // Start from scratch if the memory is taken up again.
+  memState     = FROM_POOL;
+  harvestTrick = FIRST_HARVEST_TRICK;
+  harvestHand  = 0;
+  harvested.nextBlockNo = 0;
+  timestamp    = 0;
+
+  TransTable::ReleaseCold();
+
+  pageStats.numResets     = 0;
+  pageStats.numFullResets = 0;
+  pageStats.numCallocs    = 0;
+  pageStats.numFrees      = 0;
+  pageStats.numHarvests   = 0;
+  pageStats.lastCurrent   = 0;
 
   TransTable::ReleaseTT();
 
@@ -392,6 +506,170 @@ void TransTable::ReturnAllMemory()
 }
 
 
+bool TransTable::CloneFrom(
+  TransTable            * src)
+{
+  // Makes this table a copy of another one, so that a thread can
+  // start out with the table that another thread has built up for
+  // the same deal.  Neither table may be in use while this runs.
+  // The pages are copied as they are, and then the pointers into
+  // them are moved over to the corresponding pages here.
+  // Returns false if there was not enough memory, in which case
+  // this table is left empty.
+
+  if (! src->TTInUse || src->poolp == nullptr)
+  {
+    TransTable::ResetMemory();
+    return true;
+  }
+
+  TransTable::MakeTT();
+
+  // The cold tier is not copied, as it is only a second chance.
+  TransTable::ColdReset();
+
+  poolType * sp = src->poolp;
+  int numPages = 1;
+  while (sp->prev)
+  {
+    sp = sp->prev;
+    numPages++;
+  }
+
+  winBlockType ** srcList = static_cast<winBlockType **>
+    (malloc(2 * static_cast<size_t>(numPages) * sizeof(winBlockType *)));
+  if (srcList == nullptr)
+  {
+    TransTable::ResetMemory();
+    return false;
+  }
+  winBlockType ** dstList = srcList + numPages;
+
+  // Get the same number of pages, from the first one on.
+  if (poolp == nullptr)
+  {
+    TransTable::GetNextCardBlock();
+    poolp->nextBlockNo = 0;
+  }
+  while (poolp->prev)
+    poolp = poolp->prev;
+
+  for (int p = 0; p < numPages; p++)
+  {
+    if (p > 0 && poolp->next == nullptr)
+    {
+      poolType * newpoolp = static_cast<poolType *>
+        (calloc(1, sizeof(poolType)));
+      if (newpoolp != nullptr)
+        newpoolp->list = static_cast<winBlockType *>
+          (malloc(BLOCKS_PER_PAGE * sizeof(winBlockType)));
+
+      if (newpoolp == nullptr || newpoolp->list == nullptr)
+      {
+        free(newpoolp);
+        free(srcList);
+        TransTable::ResetPages();
+        return false;
+      }
+
+      newpoolp->prev = poolp;
+      poolp->next    = newpoolp;
+      pagesCurrent++;
+    }
+
+    if (p > 0)
+      poolp = poolp->next;
+
+    srcList[p] = sp->list;
+    dstList[p] = poolp->list;
+
+    poolp->nextBlockNo = sp->nextBlockNo;
+    memcpy(poolp->list, sp->list,
+      static_cast<size_t>(sp->nextBlockNo) * sizeof(winBlockType));
+
+    sp = sp->next;
+  }
+
+  for (int t = 0; t < TT_TRICKS; t++)
+  {
+    for (int h = 0; h < DDS_HANDS; h++)
+    {
+      memcpy(TTroot[t][h], src->TTroot[t][h],
+        256 * sizeof(distHashType));
+
+      for (int w = 0; w < 4; w++)
+        rootUsed[t][h][w] = src->rootUsed[t][h][w];
+
+      for (int i = 0; i < 256; i++)
+      {
+        distHashType * dp = &TTroot[t][h][i];
+        for (int n = 0; n < dp->nextNo; n++)
+          dp->list[n].posBlock = TransTable::MoveBlock(
+            dp->list[n].posBlock, srcList, dstList, numPages);
+      }
+
+      lastBlockSeen[t][h] = TransTable::MoveBlock(
+        src->lastBlockSeen[t][h], srcList, dstList, numPages);
+    }
+  }
+
+  memState     = src->memState;
+  timestamp    = src->timestamp;
+  harvestTrick = src->harvestTrick;
+  harvestHand  = src->harvestHand;
+
+  harvested.nextBlockNo = src->harvested.nextBlockNo;
+  if (memState == FROM_HARVEST)
+  {
+    for (int n = 0; n < BLOCKS_PER_PAGE; n++)
+      harvested.list[n] = TransTable::MoveBlock(
+        src->harvested.list[n], srcList, dstList, numPages);
+  }
+
+  nextBlockp = dstList[numPages-1] + poolp->nextBlockNo;
+
+  free(srcList);
+  return true;
+}
+
+
+TransTable::winBlockType * TransTable::MoveBlock(
+  winBlockType          * bp,
+  winBlockType          * srcList[],
+  winBlockType          * dstList[],
+  int                   numPages)
+{
+  if (bp == nullptr)
+    return nullptr;
+
+  for (int p = 0; p < numPages; p++)
+  {
+    if (bp >= srcList[p] && bp < srcList[p] + BLOCKS_PER_PAGE)
+      return dstList[p] + (bp - srcList[p]);
+  }
+  return nullptr;
+}
+
+
+void TransTable::GetPageCounts(
+  int                   * resets,
+  int                   * fullResets,
+  int                   * harvests)
+{
+  * resets     = pageStats.numResets;
+  * fullResets = pageStats.numFullResets;
+  * harvests   = pageStats.numHarvests;
+}
+
+
+void TransTable::ResetPageCounts()
+{
+  pageStats.numResets     = 0;
+  pageStats.numFullResets = 0;
+  pageStats.numHarvests   = 0;
+}
+
+
 int TransTable::BlocksInUse()
 {
   poolType * pp = poolp;
@@ -412,11 +690,13 @@ double TransTable::MemoryInUse()
 {
   int blockMem = BLOCKS_PER_PAGE * pagesCurrent * 
     static_cast<int>(sizeof(winBlockType));
-  int aggrMem  = 8192 * static_cast<int>(sizeof(aggrType));
-  int rootMem  = TT_TRICKS * DDS_HANDS * 256 * 
-    static_cast<int>(sizeof(distHashType));
+  int rootMem  = (TTInUse ? TT_TRICKS * DDS_HANDS * 256 * 
+    static_cast<int>(sizeof(distHashType)) : 0);
+  double coldMem = (coldBuf == nullptr ? 0. : 
+    static_cast<double>(coldSize) + COLD_HASH_SIZE * sizeof(long long));
 
-  return (blockMem + aggrMem + rootMem) / static_cast<double>(1024.);
+  return (blockMem + rootMem + coldMem) / 
+    static_cast<double>(1024.);
 }
 
 
@@ -469,7 +749,7 @@ TransTable::winBlockType * TransTable::GetNextCardBlock()
     {
       if (! TransTable::Harvest())
       {
-        TransTable::ResetMemory();
+        TransTable::ResetWhenFull();
         poolp->nextBlockNo++;
         return nextBlockp++;
       }
@@ -495,7 +775,7 @@ TransTable::winBlockType * TransTable::GetNextCardBlock()
       // Have to try to reclaim memory.
       if (! TransTable::Harvest())
       {
-        TransTable::ResetMemory();
+        TransTable::ResetWhenFull();
         poolp->nextBlockNo++;
         return nextBlockp++;
       }
@@ -516,7 +796,7 @@ TransTable::winBlockType * TransTable::GetNextCardBlock()
         // and start over.
         if (! TransTable::Harvest())
         {
-          TransTable::ResetMemory();
+          TransTable::ResetWhenFull();
           poolp->nextBlockNo++;
           return nextBlockp++;
         }
@@ -533,7 +813,7 @@ TransTable::winBlockType * TransTable::GetNextCardBlock()
       {
         if (! TransTable::Harvest())
         {
-          TransTable::ResetMemory();
+          TransTable::ResetWhenFull();
           poolp->nextBlockNo++;
           return nextBlockp++;
         }
@@ -583,6 +863,9 @@ bool TransTable::Harvest()
         bp = ptr->list[suit].posBlock;
         if (timestamp - bp->timestampRead > HARVEST_AGE)
         {
+          TransTable::ColdStore(harvestTrick, harvestHand, 
+            ptr->list[suit].key, bp);
+
           bp->nextMatchNo     = 0;
           bp->nextWriteNo     = 0;
           bp->timestampRead   = timestamp;
@@ -628,6 +911,299 @@ bool TransTable::Harvest()
 }
 
 
+void TransTable::ColdReset()
+{
+  coldWritePos = 0;
+  if (coldHead == nullptr)
+    return;
+
+  for (int i = 0; i < COLD_HASH_SIZE; i++)
+    coldHead[i] = -1;
+}
+
+
+int TransTable::ColdHash(
+  int                   trick,
+  int                   hand,
+  long long             key)
+{
+  long long h = key ^ (key >> 17) ^ (key >> 31) ^ 
+    (static_cast<long long>(4 * trick + hand) * 0x9e3779b1);
+
+  return static_cast<int>((h ^ (h >> COLD_HASH_BITS)) & 
+    (COLD_HASH_SIZE - 1));
+}
+
+
+void TransTable::ColdPut(
+  coldBitsType          * bits,
+  unsigned              value,
+  int                   numBits)
+{
+  bits->acc |= static_cast<unsigned long long>(value) << bits->numBits;
+  bits->numBits += numBits;
+  while (bits->numBits >= 8)
+  {
+    *(bits->p++) = static_cast<unsigned char>(bits->acc & 0xff);
+    bits->acc >>= 8;
+    bits->numBits -= 8;
+  }
+}
+
+
+unsigned TransTable::ColdGet(
+  coldBitsType          * bits,
+  int                   numBits)
+{
+  while (bits->numBits < numBits)
+  {
+    bits->acc |= static_cast<unsigned long long>(*(bits->p++)) 
+      << bits->numBits;
+    bits->numBits += 8;
+  }
+  unsigned value = static_cast<unsigned>
+    (bits->acc & ((1ull << numBits) - 1));
+  bits->acc >>= numBits;
+  bits->numBits -= numBits;
+  return value;
+}
+
+
+void TransTable::ColdStore(
+  int                   trick,
+  int                   hand,
+  long long             key,
+  winBlockType          * bp)
+{
+  /*
+     An entry is bit-packed as follows.  Most of a winMatchType
+     follows from the number of cards that matter in each suit,
+     so only the owners of those cards are kept.
+
+     4 x 4 bits   number of cards in each suit that matter
+     2 x 8 bits   lower and upper bound
+     2 + 4 bits   best move
+     2 bits       owner of each card that matters
+  */
+
+  if (coldBuf == nullptr && ! TransTable::MakeCold())
+    return;
+
+  int n = bp->nextMatchNo;
+  if (n == 0)
+    return;
+
+  long long maxBytes = static_cast<long long>(sizeof(coldHeaderType)) + 
+    n * 18 + 8;
+  if (maxBytes > coldSize)
+    return;
+
+  long long offset = coldWritePos % coldSize;
+  if (offset + maxBytes > coldSize)
+  {
+    // Leave the rest of the ring empty and start over.
+    coldWritePos += coldSize - offset;
+    offset = 0;
+  }
+
+  coldHeaderType * hp = 
+    reinterpret_cast<coldHeaderType *>(coldBuf + offset);
+
+  coldBitsType bits;
+  bits.p = coldBuf + offset + sizeof(coldHeaderType);
+  bits.acc = 0;
+  bits.numBits = 0;
+
+  // Oldest entry first, so that a reloaded block is searched 
+  // in the same order.
+  int start = (n == BLOCKS_PER_ENTRY ? 
+    bp->nextWriteNo % BLOCKS_PER_ENTRY : 0);
+
+  for (int i = 0; i < n; i++)
+  {
+    winMatchType * wp = &bp->list[(start + i) % BLOCKS_PER_ENTRY];
+    unsigned topSet[TT_BYTES] = 
+      { wp->topSet1, wp->topSet2, wp->topSet3, wp->topSet4 };
+    int count[DDS_SUITS];
+
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      count[s] = 15 - ((wp->maskIndex >> (12 - 4*s)) & 0xf);
+      TransTable::ColdPut(&bits, static_cast<unsigned>(count[s]), 4);
+    }
+
+    TransTable::ColdPut(&bits, 
+      static_cast<unsigned char>(wp->first.lbound), 8);
+    TransTable::ColdPut(&bits, 
+      static_cast<unsigned char>(wp->first.ubound), 8);
+    TransTable::ColdPut(&bits, 
+      static_cast<unsigned>(wp->first.bestMoveSuit), 2);
+    TransTable::ColdPut(&bits, 
+      static_cast<unsigned>(wp->first.bestMoveRank), 4);
+
+    for (int s = 0; s < DDS_SUITS; s++)
+      for (int j = 0; j < count[s]; j++)
+        TransTable::ColdPut(&bits, (topSet[j >> 2] >> 
+          (8 * (3-s) + 6 - 2 * (j & 3))) & 3, 2);
+  }
+  TransTable::ColdPut(&bits, 0, 7);
+
+  long long numBytes = (bits.p - coldBuf) - offset;
+  numBytes = (numBytes + 7) & ~7ll;
+
+  int h = TransTable::ColdHash(trick, hand, key);
+  hp->key        = key;
+  hp->prev       = coldHead[h];
+  hp->trickHand  = 4 * trick + hand;
+  hp->numEntries = n;
+  hp->numBytes   = static_cast<int>(numBytes);
+  hp->unused     = 0;
+
+  coldHead[h]   = coldWritePos;
+  coldWritePos += numBytes;
+
+  coldStats.numStores++;
+  coldStats.numStoredEntries += n;
+  coldStats.numStoredBytes += numBytes;
+}
+
+
+bool TransTable::ColdLoad(
+  int                   trick,
+  int                   hand,
+  long long             key,
+  winBlockType          * bp)
+{
+  if (coldBuf == nullptr)
+    return false;
+
+  coldStats.numLookups++;
+
+  int h = TransTable::ColdHash(trick, hand, key);
+  long long pos = coldHead[h];
+  coldHeaderType * hp = nullptr;
+
+  // Older records in a chain are overwritten before newer ones.
+  while (pos >= 0 && pos + coldSize >= coldWritePos)
+  {
+    hp = reinterpret_cast<coldHeaderType *>(coldBuf + pos % coldSize);
+    if (hp->key == key && hp->trickHand == 4 * trick + hand)
+      break;
+    pos = hp->prev;
+    hp = nullptr;
+  }
+
+  if (hp == nullptr)
+    return false;
+
+  coldBitsType bits;
+  bits.p = reinterpret_cast<unsigned char *>(hp) + sizeof(coldHeaderType);
+  bits.acc = 0;
+  bits.numBits = 0;
+
+  int n = hp->numEntries;
+  for (int i = 0; i < n; i++)
+  {
+    winMatchType * wp = &bp->list[i];
+    unsigned topSet[TT_BYTES] = { 0, 0, 0, 0 };
+    unsigned topMask[TT_BYTES] = { 0, 0, 0, 0 };
+    int count[DDS_SUITS];
+
+    wp->xorSet = 0;
+    wp->maskIndex = 0;
+
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      count[s] = static_cast<int>(TransTable::ColdGet(&bits, 4));
+      wp->maskIndex |= (15 - count[s]) << (12 - 4*s);
+      wp->first.leastWin[s] = static_cast<char>(count[s]);
+
+      unsigned * mb = maskBytes[(1 << count[s]) - 1][s];
+      for (int b = 0; b < TT_BYTES; b++)
+        topMask[b] |= mb[b];
+    }
+
+    wp->first.lbound = static_cast<char>(TransTable::ColdGet(&bits, 8));
+    wp->first.ubound = static_cast<char>(TransTable::ColdGet(&bits, 8));
+    wp->first.bestMoveSuit = 
+      static_cast<char>(TransTable::ColdGet(&bits, 2));
+    wp->first.bestMoveRank = 
+      static_cast<char>(TransTable::ColdGet(&bits, 4));
+
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      for (int j = 0; j < count[s]; j++)
+      {
+        unsigned owner = TransTable::ColdGet(&bits, 2);
+        topSet[j >> 2] |= owner << (8 * (3-s) + 6 - 2 * (j & 3));
+        wp->xorSet ^= owner << (24 - 2*j);
+      }
+    }
+
+    wp->topSet1  = topSet[0];
+    wp->topSet2  = topSet[1];
+    wp->topSet3  = topSet[2];
+    wp->topSet4  = topSet[3];
+    wp->topMask1 = topMask[0];
+    wp->topMask2 = topMask[1];
+    wp->topMask3 = topMask[2];
+    wp->topMask4 = topMask[3];
+
+    if (topMask[1] == 0)
+      wp->lastMaskNo = 1;
+    else if (topMask[2] == 0)
+      wp->lastMaskNo = 2;
+    else if (topMask[3] == 0)
+      wp->lastMaskNo = 3;
+    else
+      wp->lastMaskNo = 4;
+  }
+
+  bp->nextMatchNo   = n;
+  bp->nextWriteNo   = n;
+  bp->timestampRead = timestamp;
+
+  coldStats.numLoads++;
+  coldStats.numLoadedEntries += n;
+  return true;
+}
+
+
+void TransTable::ColdStoreAll()
+{
+  // The whole memory is about to be reset.  Save what fits,
+  // starting with the positions that have the most tricks left,
+  // as they save the largest searches.
+
+  if (coldBuf == nullptr && ! TransTable::MakeCold())
+    return;
+
+  long long start = coldWritePos;
+
+  for (int trick = TT_TRICKS-1; trick >= 0; trick--)
+  {
+    for (int hand = 0; hand < DDS_HANDS; hand++)
+    {
+      for (int hash = 0; hash < 256; hash++)
+      {
+        distHashType * ptr = &TTroot[trick][hand][hash];
+        for (int d = 0; d < ptr->nextNo; d++)
+        {
+          // Don't overwrite what was stored in this same loop.
+          winBlockType * bp = ptr->list[d].posBlock;
+          if (coldWritePos - start + bp->nextMatchNo * 18 + 
+              static_cast<long long>(sizeof(coldHeaderType)) + 8 > 
+              coldSize)
+            return;
+
+          TransTable::ColdStore(trick, hand, ptr->list[d].key, bp);
+        }
+      }
+    }
+  }
+}
+
+
 int TransTable::hash8(int * handDist)
 {
   /*
@@ -695,7 +1271,7 @@ nodeCardsType * TransTable::Lookup(
 
   bool empty;
   lastBlockSeen[tricks][hand] =
-    LookupSuit(&TTroot[tricks][hand][hashkey], 
+    LookupSuit(tricks, hand, &TTroot[tricks][hand][hashkey], 
       suitLengths, &empty);
   if (empty)
     return nullptr;
@@ -718,6 +1294,8 @@ nodeCardsType * TransTable::Lookup(
 
 
 TransTable::winBlockType * TransTable::LookupSuit(
+  int                   trick,
+  int                   hand,
   distHashType          * dp,
   long long             key,
   bool                  * empty)
@@ -753,6 +1331,9 @@ TransTable::winBlockType * TransTable::LookupSuit(
     }
     else
       m = dp->nextWriteNo++;
+
+    TransTable::ColdStore(trick, hand, 
+      dp->list[m].key, dp->list[m].posBlock);
   }
   else
   {
@@ -763,6 +1344,11 @@ TransTable::winBlockType * TransTable::LookupSuit(
 
     winBlockType * bp = GetNextCardBlock();
     m = dp->nextWriteNo++;
+
+    // After GetNextCardBlock, which may have cleared the roots.
+    int i = static_cast<int>(dp - TTroot[trick][hand]);
+    rootUsed[trick][hand][i >> 6] |= (1ULL << (i & 63));
+
     dp->list[m].posBlock = bp;
     dp->list[m].posBlock->timestampRead = timestamp;
     dp->nextNo++;
@@ -778,6 +1364,10 @@ TransTable::winBlockType * TransTable::LookupSuit(
   dp->list[m].posBlock->nextMatchNo   = 0;
   dp->list[m].posBlock->nextWriteNo   = 0;
 
+  // The distribution may have been evicted earlier.
+  if (TransTable::ColdLoad(trick, hand, key, dp->list[m].posBlock))
+    *empty = false;
+
   return dp->list[m].posBlock;
 }
 
@@ -1872,3 +2462,45 @@ void TransTable::PrintPageSummary()
     pageStats.numHarvests,
     pageStats.numHarvests / static_cast<double>(pageStats.numResets));
 }
+
+
+void TransTable::PrintColdSummary()
+{
+  if (coldStats.numStores == 0)
+    return;
+
+  fprintf(fp, "Cold tier statistics\n\n");
+
+  fprintf(fp, "%-10s  %10s  %10s  %8s\n", 
+    "Type", "Blocks", "Entries", "Avg");
+
+  fprintf(fp, "%-10s  %10lld  %10lld  %8.2f\n",
+    "Stored",
+    coldStats.numStores,
+    coldStats.numStoredEntries,
+    coldStats.numStoredEntries / 
+      static_cast<double>(coldStats.numStores));
+
+  fprintf(fp, "%-10s  %10lld  %10lld  %8.2f\n",
+    "Loaded",
+    coldStats.numLoads,
+    coldStats.numLoadedEntries,
+    (coldStats.numLoads == 0 ? 0. :
+      coldStats.numLoadedEntries / 
+        static_cast<double>(coldStats.numLoads)));
+
+  fprintf(fp, "%-10s  %10lld  %10s  %7.2f%%\n",
+    "Lookups",
+    coldStats.numLookups,
+    "",
+    (coldStats.numLookups == 0 ? 0. :
+      100. * coldStats.numLoads / 
+        static_cast<double>(coldStats.numLookups)));
+
+  fprintf(fp, "%-10s  %10s  %10.2f  %8s\n\n",
+    "Bytes/entry",
+    "",
+    coldStats.numStoredBytes / 
+      static_cast<double>(coldStats.numStoredEntries),
+    "");
+}
@@ -41,6 +41,9 @@
 
 #define HISTSIZE                100000
 
+#define COLD_HASH_BITS             14
+#define COLD_HASH_SIZE          (1 << COLD_HASH_BITS)
+
 
 // Also used in ABSearch
 struct nodeCardsType // 8 bytes
@@ -55,6 +58,14 @@ struct nodeCardsType // 8 bytes
 
 class TransTable
 {
+  public:
+
+    struct aggrType // 80 bytes
+    {
+      unsigned          aggrRanks[DDS_SUITS];
+      unsigned          aggrBytes[DDS_SUITS][TT_BYTES];
+    };
+
   private:
 
     struct winMatchType // 52 bytes
@@ -89,12 +100,6 @@ class TransTable
       posSearchType     list[DISTS_PER_ENTRY];
     };
 
-    struct aggrType // 80 bytes
-    {
-      unsigned          aggrRanks[DDS_SUITS];
-      unsigned          aggrBytes[DDS_SUITS][TT_BYTES];
-    };
-
     struct poolType // 16 bytes
     {
       poolType          * next;
@@ -106,6 +111,7 @@ class TransTable
     struct pageStatsType
     {
       int               numResets,
+                        numFullResets,
                         numCallocs,
                         numFrees,
                         numHarvests,
@@ -118,6 +124,39 @@ class TransTable
       winBlockType      * list [BLOCKS_PER_PAGE];
     };
 
+    // The cold tier keeps blocks that are evicted from the pages
+    // in a compressed form.  The records are written into a ring
+    // buffer, and each record is chained to an older record with
+    // the same hash.  A record has been overwritten once the ring
+    // position has moved more than coldSize beyond it.
+
+    struct coldHeaderType // 32 bytes
+    {
+      long long         key;
+      long long         prev;
+      int               trickHand;
+      int               numEntries;
+      int               numBytes;
+      int               unused;
+    };
+
+    struct coldBitsType
+    {
+      unsigned char     * p;
+      unsigned long long acc;
+      int               numBits;
+    };
+
+    struct coldStatsType
+    {
+      long long         numStores,
+                        numStoredEntries,
+                        numStoredBytes,
+                        numLookups,
+                        numLoads,
+                        numLoadedEntries;
+    };
+
     enum memStateType
     {
       FROM_POOL,
@@ -138,8 +177,9 @@ class TransTable
     pageStatsType       pageStats;
 
 
-    // aggr is constant for a given hand.
-    aggrType            aggr[8192]; // 64 KB
+    // aggr is constant for a given hand.  It belongs to the deal
+    // tables, which the threads on the same cards share.
+    aggrType            * aggr; // 640 KB
 
     // This is the real transposition table.
     // The last index is the hash.
@@ -147,6 +187,11 @@ class TransTable
     // distHashType     TTroot[TT_TRICKS][DDS_HANDS][256];
     distHashType        * TTroot[TT_TRICKS][DDS_HANDS];
 
+    // One bit per hash position that has held a distribution
+    // since the last InitTT, which then only clears those.
+    // A search touches about a fifth of them.
+    unsigned long long  rootUsed[TT_TRICKS][DDS_HANDS][4];
+
     int                 TTInUse;
 
     // It is useful to remember the last block we looked at.
@@ -157,6 +202,12 @@ class TransTable
     winBlockType        * nextBlockp;
     harvestedType       harvested;
 
+    unsigned char       * coldBuf;
+    long long           coldSize,
+                        coldWritePos;
+    long long           * coldHead;
+    coldStatsType       coldStats;
+
 
     void InitTT();
 
@@ -171,6 +222,8 @@ class TransTable
     winBlockType * GetNextCardBlock();
 
     winBlockType * LookupSuit(
+      int               trick,
+      int               hand,
       distHashType      * dp,
       long long         key,
       bool              * empty);
@@ -188,6 +241,50 @@ class TransTable
       bool              flag);
 
     bool Harvest();
+
+    winBlockType * MoveBlock(
+      winBlockType      * bp,
+      winBlockType      * srcList[],
+      winBlockType      * dstList[],
+      int               numPages);
+
+    void ResetWhenFull();
+
+    void ResetPages();
+
+    int ColdHash(
+      int               trick,
+      int               hand,
+      long long         key);
+
+    void ColdPut(
+      coldBitsType      * bits,
+      unsigned          value,
+      int               numBits);
+
+    unsigned ColdGet(
+      coldBitsType      * bits,
+      int               numBits);
+
+    void ColdStore(
+      int               trick,
+      int               hand,
+      long long         key,
+      winBlockType      * bp);
+
+    bool ColdLoad(
+      int               trick,
+      int               hand,
+      long long         key,
+      winBlockType      * bp);
+
+    void ColdStoreAll();
+
+    void ColdReset();
+
+    bool MakeCold();
+
+    void ReleaseCold();
     
     // Debug
 
@@ -285,12 +382,22 @@ class TransTable
 
     ~TransTable();
 
-    void Init(int handLookup[][15]);
+    static void MakeAggr(
+      int               handLookup[][15],
+      aggrType          aggrList[]);
+
+    void SetAggr(
+      aggrType          * aggrList);
 
     void SetMemoryDefault(int megabytes);
 
     void SetMemoryMaximum(int megabytes);
 
+    void SetMemoryCold(int megabytes);
+
+    bool CloneFrom(
+      TransTable        * src);
+
     void MakeTT();
 
     void ResetMemory();
@@ -299,6 +406,13 @@ class TransTable
 
     double MemoryInUse();
 
+    void GetPageCounts(
+      int               * resets,
+      int               * fullResets,
+      int               * harvests);
+
+    void ResetPageCounts();
+
     void Top4Ranks(
       unsigned short    aggrTarget[],
       unsigned          rr[DDS_SUITS]);
@@ -340,10 +454,10 @@ class TransTable
 
     // Examples:
     // int hd[DDS_HANDS] = { 0x0342, 0x0334, 0x0232, 0x0531 };
-    // thrp->transTable.PrintEntriesDist(11, 1, hd);
+    // thrp->transTable->PrintEntriesDist(11, 1, hd);
     // unsigned short ag[DDS_HANDS] = 
     //   { 0x1fff, 0x1fff, 0x0f75, 0x1fff };
-    // thrp->transTable.PrintEntriesDistAndCards(11, 1, ag, hd);
+    // thrp->transTable->PrintEntriesDistAndCards(11, 1, ag, hd);
 
     void PrintEntriesDist(
       int               trick,
@@ -372,6 +486,8 @@ class TransTable
 
     void PrintPageSummary();
 
+    void PrintColdSummary();
+
 
     // Could also be made private, see above.
     int BlocksInUse();
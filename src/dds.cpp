@@ -12,6 +12,7 @@
 #include "../include/dll.h"
 #include "dds.h"
 #include "Init.h"
+#include "SuitTricks.h"
 
 
 #ifdef _MANAGED
@@ -38,6 +39,7 @@ extern "C" BOOL APIENTRY DllMain(
   {
     CloseDebugFiles();
     FreeMemory();
+    FreeSuitTricks();
 #ifdef DDS_MEMORY_LEAKS_WIN32
     _CrtDumpMemoryLeaks();
 #endif
@@ -61,6 +63,7 @@ static void __attribute__ ((destructor)) libEnd(void)
 {
   CloseDebugFiles();
   FreeMemory();
+  FreeSuitTricks();
 }
 
 #endif
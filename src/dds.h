@@ -35,8 +35,7 @@
 
 #define THREADMEM_MAX_MB        160
 #define THREADMEM_DEF_MB         95
-
-#define MAXNOOFTHREADS          16
+#define THREADMEM_COLD_MB         0
 
 #define MAXNODE                 1
 #define MINNODE                 0
@@ -11,6 +11,8 @@
 #ifndef DDS_THREADMEMH
 #define DDS_DDSH
 
+#include <atomic>
+
 struct WinnerEntryType {
   int                   suit,
                         winnerRank,
@@ -25,6 +27,11 @@ struct WinnersType {
 };
 
 
+// The frontier of a horizon search, see SolveBoardHorizon.
+#define DDS_HORIZON_ESTIMATE    0
+#define DDS_HORIZON_LOWER       1
+#define DDS_HORIZON_UPPER       2
+
 struct localVarType 
 {
   int                   nodeTypeStore[DDS_HANDS];
@@ -42,15 +49,60 @@ struct localVarType
   struct moveType       bestMove[50];
   struct moveType       bestMoveTT[50];
 
-  double                memUsed;
+  double                memUsed,
+                        memDefault, // For one table when it starts
+                        memMax; // For all its tables together
   int                   nodes;
   int                   trickNodes;
 
-  // Constant for a given hand.
-  // 960 KB
-  struct relRanksType   rel[8192];
-
-  TransTable            transTable;     // Object
+  // A horizon search stops after horizon tricks, in ABsearch0 at
+  // horizonDepth.  0 is a normal, exact search.
+  int                   horizon;
+  int                   horizonDepth;
+  int                   horizonMode;
+
+  // Time in MicroTime() at which a batch gives up, or 0.  A search
+  // that runs past it sets expired, and SolveBoard keeps the bounds
+  // that were proven until then.
+  long long             deadline;
+  bool                  expired;
+  int                   lowerBound,
+                        upperBound;
+
+  // With a progress callback, the time in MicroTime() at which the
+  // call started, and at which the next report is due, or 0.  A
+  // search is only watched with a deadline, a callback or a
+  // stopFlag.
+  long long             startTime;
+  long long             nextReport;
+  bool                  watched;
+  bool                  cancelled;
+
+  // Set while the thread ponders.  Once the flag is raised, the
+  // search is cancelled as with the progress callback.
+  std::atomic<bool>     * stopFlag;
+
+  // The best score of the next position with solutions == 3, when
+  // the caller already knows it from an earlier position.
+  bool                  scoreKnown;
+  int                   knownScore;
+  time_t                lastUsed;
+
+  // Constant for a given hand, and shared with the other threads
+  // that solve the same cards.  rel points into tables.
+  bool                  active;
+  struct dealTablesType * tables;
+  struct relRanksType   * rel;
+
+  // One table per strain of the current deal, so that a thread
+  // that goes back and forth between strains finds its entries
+  // again.  transTable is the one in use.  A table with tableUsed
+  // 0 holds nothing for the current deal.
+  TransTable            strainTables[DDS_STRAINS]; // Objects
+  int                   tableStrain[DDS_STRAINS];
+  long long             tableUsed[DDS_STRAINS];
+  long long             tableClock;
+  TransTable            * transTable;
 
   Moves                 moves;          // Object
 
@@ -149,6 +149,13 @@ bool loop_dealerpar(
   struct parResultsDealer       * dealerpar_list,
   int                           number);
 
+bool loop_calcdealerpar(
+  int                           * dealer_list,
+  int                           * vul_list,
+  struct dealPBN                * deal_list,
+  struct parResultsDealer       * dealerpar_list,
+  int                           number);
+
 bool loop_play(
   struct boardsPBN              * bop,
   struct playTracesPBN          * playsp,
@@ -161,6 +168,21 @@ bool loop_play(
 void print_times(
   int                           number);
 
+void scale_start(
+  int                           threads);
+
+bool scale_end(
+  int                           threads);
+
+double scale_idle(
+  int                           userTime,
+  struct threadStat             * tp);
+
+void scale_print(
+  char                          * fname,
+  char                          * type,
+  int                           number);
+
 #ifndef _WIN32
 int timeval_diff(
   timeval                       x, 
@@ -171,6 +193,10 @@ void timer_start();
 
 int timer_end();
 
+bool pbn_to_cards(
+  char                          * pbn,
+  unsigned                      cards[DDS_HANDS][DDS_SUITS]);
+
 bool consume_int(
   char                          * line,
   int                           * pos,
@@ -0,0 +1,596 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+/*
+   htest searches for deals that take DDS a long time to solve,
+   and writes them as a hands file that dtest can read.
+
+   The cost of a deal is the number of nodes of the search that
+   gives its FUT line, with target -1, solutions 3 and mode 1.
+   Each search starts from an empty table (SetDeterministic), so
+   the counts do not depend on the number of threads, and a run
+   is reproducible from its seed.
+
+   The corpus is stratified by strain and by class of difficulty.
+   For each strain htest climbs from a random deal:  Each round it
+   tries HT_MUTANTS deals in which two hands have swapped a card,
+   and it goes on from the hardest of them if that is harder than
+   the deal so far.  The first deal of a climb that reaches a class
+   is kept in that class, as long as the class needs more deals.
+   A class that the climb jumps over is left to a later climb.
+   A climb ends when no class above the deal still needs one, or
+   when it has not improved for HT_STALL rounds.
+
+   The random deal that a climb starts from is the one with the
+   highest fanout out of HT_SEEDS, in the same sense as in the
+   scheduler.  The fanout is a cheap but weak predictor of the
+   node count.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../include/dll.h"
+
+#define HT_CLASSES       3
+#define HT_MUTANTS       8
+#define HT_SEEDS        16
+#define HT_STALL        20
+#define HT_MAX_ROUNDS  200
+
+using namespace std;
+using namespace std::chrono;
+
+
+struct hardDealType
+{
+  deal                  dl;
+  int                   dealer;
+  int                   vul;
+  int                   cls;
+  int                   nodes;
+};
+
+
+// The lowest node count of each class.
+const int classNodes[HT_CLASSES] = { 1000000, 4000000, 16000000 };
+
+const char * strainNames[DDS_STRAINS] =
+{
+  "Spades", "Hearts", "Diamonds", "Clubs", "Notrump"
+};
+
+const char cardHand[DDS_HANDS] = { 'N', 'E', 'S', 'W' };
+const char cardSuit[DDS_SUITS] = { 'S', 'H', 'D', 'C' };
+const char cardRank[15] =
+{
+  'x', 'x', '2', '3', '4', '5', '6', '7',
+  '8', '9', 'T', 'J', 'Q', 'K', 'A'
+};
+
+unsigned long long rngState;
+
+boards                  evalBoards;
+solvedBoards            evalSolved;
+
+
+unsigned long long next_random();
+
+int suit_groups(
+  unsigned              holding);
+
+int fanout(
+  const deal            * dl);
+
+void random_deal(
+  int                   strain,
+  deal                  * dl);
+
+void mutate(
+  deal                  * dl);
+
+int get_class(
+  int                   nodes);
+
+bool any_needed(
+  int                   need[],
+  int                   from);
+
+bool evaluate(
+  const deal            * dls,
+  int                   number,
+  int                   * nodes);
+
+bool climb(
+  int                   strain,
+  int                   need[],
+  vector<hardDealType>  * corpus,
+  long long             startTime);
+
+bool write_corpus(
+  const char            * fname,
+  vector<hardDealType>  * corpus);
+
+bool print_deal(
+  FILE                  * fp,
+  hardDealType          * hp);
+
+bool check_return(
+  int                   res,
+  const char            * fname);
+
+void print_summary(
+  vector<hardDealType>  * corpus);
+
+long long elapsed_ms(
+  long long             startTime);
+
+
+int main(int argc, char * argv[])
+{
+  if (argc < 2 || argc > 5)
+  {
+    printf("Usage: htest file.txt [perClass] [seed] [threads]\n");
+    return 1;
+  }
+
+  int perClass = (argc >= 3 ? atoi(argv[2]) : 1);
+  rngState     = (argc >= 4 ? strtoull(argv[3], nullptr, 10) : 1);
+  int threads  = (argc == 5 ? atoi(argv[4]) : 0);
+
+  if (perClass < 1)
+    perClass = 1;
+
+  SetMaxThreads(threads);
+  SetDeterministic(1);
+
+  long long startTime = elapsed_ms(0);
+  vector<hardDealType> corpus;
+
+  for (int strain = 0; strain < DDS_STRAINS; strain++)
+  {
+    int need[HT_CLASSES];
+    for (int c = 0; c < HT_CLASSES; c++)
+      need[c] = perClass;
+
+    while (any_needed(need, 0))
+    {
+      if (! climb(strain, need, &corpus, startTime))
+        return 1;
+    }
+  }
+
+  if (! write_corpus(argv[1], &corpus))
+    return 1;
+
+  print_summary(&corpus);
+  printf("%-20s  %10.1f s\n", "Total time",
+    static_cast<double>(elapsed_ms(startTime)) / 1000.);
+
+  FreeMemory();
+  return 0;
+}
+
+
+unsigned long long next_random()
+{
+  // splitmix64, as in the deal generator of the library.
+  unsigned long long z = (rngState += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+
+int suit_groups(
+  unsigned              holding)
+{
+  // Runs of adjacent ranks, so KT982 has 3 groups.
+  int groups = 0;
+  bool inGroup = false;
+  for (int r = 14; r >= 2; r--)
+  {
+    if (holding & (1u << r))
+    {
+      if (! inGroup)
+        groups++;
+      inGroup = true;
+    }
+    else
+      inGroup = false;
+  }
+  return groups;
+}
+
+
+int fanout(
+  const deal            * dl)
+{
+  // As Scheduler::Fanout:  A void counts as the sum of the groups
+  // in the other suits of the hand.
+  int fan = 0;
+  for (int h = 0; h < DDS_HANDS; h++)
+  {
+    int fanSuit = 0, voids = 0;
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      fanSuit += suit_groups(dl->remainCards[h][s]);
+      if (dl->remainCards[h][s] == 0)
+        voids++;
+    }
+    fan += fanSuit + voids * fanSuit;
+  }
+  return fan;
+}
+
+
+void random_deal(
+  int                   strain,
+  deal                  * dl)
+{
+  dealConstraints cons;
+  memset(&cons, 0, sizeof(cons));
+  for (int h = 0; h < DDS_HANDS; h++)
+  {
+    cons.maxHCP[h] = 37;
+    for (int s = 0; s < DDS_SUITS; s++)
+      cons.maxLength[h][s] = 13;
+  }
+
+  ddTableDeal tableDeals[HT_SEEDS];
+  GenerateDeals(&cons, next_random(), HT_SEEDS, tableDeals);
+
+  int bestFan = -1;
+  for (int n = 0; n < HT_SEEDS; n++)
+  {
+    deal cand;
+    memset(&cand, 0, sizeof(cand));
+    memcpy(cand.remainCards, tableDeals[n].cards,
+      sizeof(cand.remainCards));
+
+    int fan = fanout(&cand);
+    if (fan > bestFan)
+    {
+      bestFan = fan;
+      * dl = cand;
+    }
+  }
+
+  dl->trump = strain;
+  dl->first = static_cast<int>(next_random() % DDS_HANDS);
+}
+
+
+void mutate(
+  deal                  * dl)
+{
+  // One random card of each of two hands changes places.
+  int h1 = static_cast<int>(next_random() % DDS_HANDS);
+  int h2 = (h1 + 1 + static_cast<int>(next_random() % 3)) % DDS_HANDS;
+  int hands[2] = { h1, h2 };
+  int suits[2] = { 0, 0 }, ranks[2] = { 0, 0 };
+
+  for (int k = 0; k < 2; k++)
+  {
+    int index = static_cast<int>(next_random() % 13);
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      for (int r = 14; r >= 2; r--)
+      {
+        if ((dl->remainCards[hands[k]][s] & (1u << r)) && index-- == 0)
+        {
+          suits[k] = s;
+          ranks[k] = r;
+        }
+      }
+    }
+  }
+
+  dl->remainCards[h1][suits[0]] ^= (1u << ranks[0]);
+  dl->remainCards[h2][suits[0]] ^= (1u << ranks[0]);
+  dl->remainCards[h2][suits[1]] ^= (1u << ranks[1]);
+  dl->remainCards[h1][suits[1]] ^= (1u << ranks[1]);
+}
+
+
+int get_class(
+  int                   nodes)
+{
+  int cls = -1;
+  for (int c = 0; c < HT_CLASSES; c++)
+    if (nodes >= classNodes[c])
+      cls = c;
+  return cls;
+}
+
+
+bool any_needed(
+  int                   need[],
+  int                   from)
+{
+  for (int c = from; c < HT_CLASSES; c++)
+    if (need[c] > 0)
+      return true;
+  return false;
+}
+
+
+bool evaluate(
+  const deal            * dls,
+  int                   number,
+  int                   * nodes)
+{
+  evalBoards.noOfBoards = number;
+  for (int n = 0; n < number; n++)
+  {
+    evalBoards.deals[n]     = dls[n];
+    evalBoards.target[n]    = -1;
+    evalBoards.solutions[n] = 3;
+    evalBoards.mode[n]      = 1;
+  }
+
+  if (! check_return(SolveAllChunksBin(&evalBoards, &evalSolved, 1),
+      "SolveAllChunksBin"))
+    return false;
+
+  for (int n = 0; n < number; n++)
+    nodes[n] = evalSolved.solvedBoard[n].nodes;
+  return true;
+}
+
+
+bool climb(
+  int                   strain,
+  int                   need[],
+  vector<hardDealType>  * corpus,
+  long long             startTime)
+{
+  hardDealType cur;
+  random_deal(strain, &cur.dl);
+  cur.dealer = static_cast<int>(next_random() % DDS_HANDS);
+  cur.vul    = static_cast<int>(next_random() % 4);
+
+  if (! evaluate(&cur.dl, 1, &cur.nodes))
+    return false;
+
+  int kept = -1, stall = 0;
+  for (int round = 0; round < HT_MAX_ROUNDS && stall < HT_STALL;
+      round++)
+  {
+    // Keep the deal in its class the first time it gets there.
+    cur.cls = get_class(cur.nodes);
+    if (cur.cls > kept && need[cur.cls] > 0)
+    {
+      corpus->push_back(cur);
+      need[cur.cls]--;
+
+      printf("%-8s  class %d  %10d nodes  round %3d  %8.1f s\n",
+        strainNames[strain], cur.cls, cur.nodes, round,
+        static_cast<double>(elapsed_ms(startTime)) / 1000.);
+      fflush(stdout);
+    }
+    kept = max(kept, cur.cls);
+
+    if (! any_needed(need, kept + 1))
+      break;
+
+    deal mutants[HT_MUTANTS];
+    int nodes[HT_MUTANTS];
+    for (int m = 0; m < HT_MUTANTS; m++)
+    {
+      mutants[m] = cur.dl;
+      mutate(&mutants[m]);
+    }
+
+    if (! evaluate(mutants, HT_MUTANTS, nodes))
+      return false;
+
+    int best = -1;
+    for (int m = 0; m < HT_MUTANTS; m++)
+    {
+      if (nodes[m] > cur.nodes)
+      {
+        cur.nodes = nodes[m];
+        best = m;
+      }
+    }
+
+    if (best == -1)
+      stall++;
+    else
+    {
+      cur.dl = mutants[best];
+      stall = 0;
+    }
+  }
+  return true;
+}
+
+
+bool write_corpus(
+  const char            * fname,
+  vector<hardDealType>  * corpus)
+{
+  FILE * fp = fopen(fname, "w");
+  if (fp == nullptr)
+  {
+    printf("Could not open %s\n", fname);
+    return false;
+  }
+
+  // By strain, and within a strain by class.
+  fprintf(fp, "NUMBER %d \n", static_cast<int>(corpus->size()));
+  for (int strain = 0; strain < DDS_STRAINS; strain++)
+  {
+    for (int c = 0; c < HT_CLASSES; c++)
+    {
+      for (auto& hd: * corpus)
+      {
+        if (hd.dl.trump == strain && hd.cls == c &&
+            ! print_deal(fp, &hd))
+        {
+          fclose(fp);
+          return false;
+        }
+      }
+    }
+  }
+
+  fclose(fp);
+  return true;
+}
+
+
+bool print_deal(
+  FILE                  * fp,
+  hardDealType          * hp)
+{
+  // The reference results come from the same calls as in dtest.
+
+  deal * dl = &hp->dl;
+  fprintf(fp, "PBN %d %d %d %d \"%c:",
+    hp->dealer, hp->vul, dl->trump, dl->first, cardHand[hp->dealer]);
+  for (int k = 0; k < DDS_HANDS; k++)
+  {
+    int h = (hp->dealer + k) % DDS_HANDS;
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      for (int r = 14; r >= 2; r--)
+        if (dl->remainCards[h][s] & (1u << r))
+          fputc(cardRank[r], fp);
+      if (s < DDS_SUITS - 1)
+        fputc('.', fp);
+    }
+    if (k < DDS_HANDS - 1)
+      fputc(' ', fp);
+  }
+  fprintf(fp, "\" \n");
+
+  futureTricks fut;
+  if (! check_return(SolveBoard(* dl, -1, 3, 1, &fut, 0),
+      "SolveBoard"))
+    return false;
+  fprintf(fp, "FUT %d ", fut.cards);
+  for (int c = 0; c < fut.cards; c++)
+    fprintf(fp, "%d ", fut.suit[c]);
+  for (int c = 0; c < fut.cards; c++)
+    fprintf(fp, "%d ", fut.rank[c]);
+  for (int c = 0; c < fut.cards; c++)
+    fprintf(fp, "%d ", fut.equals[c]);
+  for (int c = 0; c < fut.cards; c++)
+    fprintf(fp, "%d ", fut.score[c]);
+  fprintf(fp, "\n");
+
+  ddTableDeal tableDeal;
+  ddTableResults table;
+  memcpy(tableDeal.cards, dl->remainCards, sizeof(tableDeal.cards));
+  if (! check_return(CalcDDtable(tableDeal, &table), "CalcDDtable"))
+    return false;
+  fprintf(fp, "TABLE ");
+  for (int s = 0; s < DDS_STRAINS; s++)
+    for (int h = 0; h < DDS_HANDS; h++)
+      fprintf(fp, "%d ", table.resTable[s][h]);
+  fprintf(fp, "\n");
+
+  parResults par;
+  if (! check_return(Par(&table, &par, hp->vul), "Par"))
+    return false;
+  fprintf(fp, "PAR \"%s\" \"%s\" \"%s\" \"%s\" \n",
+    par.parScore[0], par.parScore[1],
+    par.parContractsString[0], par.parContractsString[1]);
+
+  parResultsDealer dpar;
+  if (! check_return(DealerPar(&table, &dpar, hp->dealer, hp->vul),
+      "DealerPar"))
+    return false;
+  fprintf(fp, "PAR2 \"%d\" ", dpar.score);
+  for (int n = 0; n < dpar.number; n++)
+    fprintf(fp, "\"%s\" ", dpar.contracts[n]);
+  fprintf(fp, "\n");
+
+  // The play is the best lead, and its trace the two positions.
+  playTraceBin play;
+  solvedPlay solved;
+  play.number  = 1;
+  play.suit[0] = fut.suit[0];
+  play.rank[0] = fut.rank[0];
+  if (! check_return(AnalysePlayBin(* dl, play, &solved, 0),
+      "AnalysePlayBin"))
+    return false;
+
+  fprintf(fp, "PLAY 1 \"%c%c\" \n",
+    cardSuit[fut.suit[0]], cardRank[fut.rank[0]]);
+  fprintf(fp, "TRACE %d ", solved.number);
+  for (int n = 0; n < solved.number; n++)
+    fprintf(fp, "%d ", solved.tricks[n]);
+  fprintf(fp, "\n");
+  return true;
+}
+
+
+bool check_return(
+  int                   res,
+  const char            * fname)
+{
+  if (res == RETURN_NO_FAULT)
+    return true;
+
+  char line[80];
+  ErrorMessage(res, line);
+  printf("%s: %s\n", fname, line);
+  return false;
+}
+
+
+void print_summary(
+  vector<hardDealType>  * corpus)
+{
+  printf("\n%-8s", "Strain");
+  for (int c = 0; c < HT_CLASSES; c++)
+    printf("  %10s %d", "class", c);
+  printf("\n");
+
+  // The median node count of each class.
+  for (int strain = 0; strain < DDS_STRAINS; strain++)
+  {
+    printf("%-8s", strainNames[strain]);
+    for (int c = 0; c < HT_CLASSES; c++)
+    {
+      vector<int> nodes;
+      for (auto& hd: * corpus)
+        if (hd.dl.trump == strain && hd.cls == c)
+          nodes.push_back(hd.nodes);
+
+      if (nodes.empty())
+        printf("  %12s", "-");
+      else
+      {
+        sort(nodes.begin(), nodes.end());
+        printf("  %12d", nodes[nodes.size() / 2]);
+      }
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+
+long long elapsed_ms(
+  long long             startTime)
+{
+  return duration_cast<milliseconds>(
+    steady_clock::now().time_since_epoch()).count() - startTime;
+}
@@ -0,0 +1,440 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+/*
+   ptest solves the DD tables of a hand file with several worker
+   processes instead of several threads.  The library is set up
+   once before the fork, so the constant tables are shared between
+   the workers copy-on-write.  The deals are written once to a
+   temporary file of remainCards holdings, and the workers map that
+   file and write their results straight into a mapped temporary
+   output file.  Work is handed out in shards of MAXNOOFTABLES
+   deals through a counter in shared memory, so a slow deal only
+   holds up its own worker.
+
+   For comparison, "threads" mode runs the same mapped files
+   through a single process with the given number of threads.
+
+   This only works on Unix-like systems.  The memory columns are
+   only filled in on Linux.  The exit status is 1 if a worker
+   failed or a result differs from the hand file.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/dll.h"
+#include "testcommon.h"
+
+#ifdef _WIN32
+
+int main()
+{
+  printf("ptest needs fork() and mmap()\n");
+  return 1;
+}
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define PTEST_MAX_WORKERS 64
+
+#define HOLDINGS    (DDS_HANDS * DDS_SUITS)
+#define TRICKS      (DDS_STRAINS * DDS_HANDS)
+
+
+struct workerType
+{
+  int                   shards;
+  int                   deals;
+  int                   timeMs;
+  long                  rssKB;
+  long                  pssKB;
+};
+
+struct controlType
+{
+  int volatile          next;
+  workerType            worker[PTEST_MAX_WORKERS];
+};
+
+
+bool pbn_to_holdings(
+  const char            * pbn,
+  unsigned short        * hold);
+
+void * map_temp(
+  size_t                size);
+
+bool run_worker(
+  controlType           * ctl,
+  workerType            * wp,
+  int                   number,
+  const unsigned short  * holdings,
+  unsigned char         * tricks);
+
+long status_kb(
+  const char            * fname,
+  const char            * key);
+
+int ms_since(
+  timeval               * t0);
+
+
+int main(int argc, char * argv[])
+{
+  if (argc != 4 && argc != 5)
+  {
+    printf("Usage: ptest file.txt procs|threads n [number]\n");
+    return 1;
+  }
+
+  char * fname = argv[1];
+  bool procs   = (strcmp(argv[2], "procs") == 0);
+  int n        = atoi(argv[3]);
+
+  if ((! procs && strcmp(argv[2], "threads")) ||
+      n < 1 || n > PTEST_MAX_WORKERS)
+  {
+    printf("Usage: ptest file.txt procs|threads n [number]\n");
+    return 1;
+  }
+
+  int                   * dealer_list;
+  int                   * vul_list;
+  dealPBN               * deal_list;
+  futureTricks          * fut_list;
+  ddTableResults        * table_list;
+  parResults            * par_list;
+  parResultsDealer      * dealerpar_list;
+  playTracePBN          * play_list;
+  solvedPlay            * trace_list;
+  int                   number;
+
+  if (read_file(fname, &number, &dealer_list, &vul_list,
+    &deal_list, &fut_list, &table_list, &par_list, &dealerpar_list,
+    &play_list, &trace_list) == false)
+  {
+    printf("read_file failed.\n");
+    return 1;
+  }
+
+  if (argc == 5 && atoi(argv[4]) < number)
+    number = atoi(argv[4]);
+
+  // Write the deals once in binary form, then map them.
+
+  size_t number_t  = static_cast<size_t>(number);
+  size_t dealSize  = number_t * HOLDINGS * sizeof(unsigned short);
+  size_t trickSize = number_t * TRICKS;
+
+  unsigned short * holdings = static_cast<unsigned short *>
+    (map_temp(dealSize));
+  unsigned char * tricks = static_cast<unsigned char *>
+    (map_temp(trickSize));
+  if (holdings == nullptr || tricks == nullptr)
+    return 1;
+
+  for (int i = 0; i < number; i++)
+  {
+    if (! pbn_to_holdings(deal_list[i].remainCards,
+        holdings + HOLDINGS * i))
+    {
+      printf("Bad PBN deal %d\n", i);
+      return 1;
+    }
+  }
+  msync(holdings, dealSize, MS_SYNC);
+
+  controlType * ctl = static_cast<controlType *>
+    (mmap(nullptr, sizeof(controlType), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  if (ctl == MAP_FAILED)
+    return 1;
+  memset(ctl, 0, sizeof(controlType));
+
+  timeval t0;
+  gettimeofday(&t0, nullptr);
+  int failures = 0;
+
+  if (procs)
+  {
+    // Everything set up here is shared with the workers.
+    SetMaxThreads(1);
+
+    for (int w = 0; w < n; w++)
+    {
+      pid_t pid = fork();
+      if (pid < 0)
+      {
+        printf("fork failed\n");
+        return 1;
+      }
+      else if (pid == 0)
+      {
+        bool ok = run_worker(ctl, &ctl->worker[w], number, 
+          holdings, tricks);
+        _exit(ok ? 0 : 1);
+      }
+    }
+
+    int status;
+    while (wait(&status) > 0)
+    {
+      if (! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      {
+        printf("Worker failed\n");
+        failures++;
+      }
+    }
+  }
+  else
+  {
+    SetMaxThreads(n);
+    if (! run_worker(ctl, &ctl->worker[0], number, holdings, tricks))
+      failures++;
+    n = 1;
+  }
+
+  int timeMs = ms_since(&t0);
+
+  int diffs = 0;
+  for (int i = 0; i < number; i++)
+  {
+    unsigned char * tp = tricks + TRICKS * i;
+    for (int s = 0; s < DDS_STRAINS; s++)
+      for (int h = 0; h < DDS_HANDS; h++)
+        if (tp[DDS_HANDS * s + h] != table_list[i].resTable[s][h])
+          diffs++;
+  }
+
+  printf("%-20s  %12s\n", "Mode", argv[2]);
+  printf("%-20s  %12s\n", "Workers", argv[3]);
+  printf("%-20s  %12d\n", "Number of hands", number);
+  printf("%-20s  %12d\n", "Time (ms)", timeMs);
+  if (timeMs > 0)
+    printf("%-20s  %12.2f\n", "Tables per second",
+      1000. * number / timeMs);
+  printf("%-20s  %12d\n\n", "Differences", diffs);
+
+  long sumRss = 0, sumPss = 0;
+  printf("%6s  %6s  %6s  %10s  %10s  %10s\n",
+    "Worker", "Shards", "Deals", "Time (ms)", "RSS (KB)", "PSS (KB)");
+  for (int w = 0; w < n; w++)
+  {
+    workerType * wp = &ctl->worker[w];
+    printf("%6d  %6d  %6d  %10d  %10ld  %10ld\n",
+      w, wp->shards, wp->deals, wp->timeMs, wp->rssKB, wp->pssKB);
+    sumRss += wp->rssKB;
+    sumPss += wp->pssKB;
+  }
+  printf("%6s  %6s  %6s  %10s  %10ld  %10ld\n\n",
+    "Sum", "", "", "", sumRss, sumPss);
+
+  munmap(holdings, dealSize);
+  munmap(tricks, trickSize);
+  munmap(ctl, sizeof(controlType));
+
+  free(dealer_list);
+  free(vul_list);
+  free(deal_list);
+  free(fut_list);
+  free(table_list);
+  free(par_list);
+  free(dealerpar_list);
+  free(play_list);
+  free(trace_list);
+
+  return (failures == 0 && diffs == 0 ? 0 : 1);
+}
+
+
+bool pbn_to_holdings(
+  const char            * pbn,
+  unsigned short        * hold)
+{
+  const char * hands = "NESW";
+  const char * ranks = "23456789TJQKA";
+
+  const char * p = strchr(hands, pbn[0]);
+  if (p == nullptr || pbn[1] != ':')
+    return false;
+
+  int h = static_cast<int>(p - hands);
+  int s = 0;
+
+  for (int i = 0; i < HOLDINGS; i++)
+    hold[i] = 0;
+
+  for (const char * c = pbn + 2; *c; c++)
+  {
+    if (*c == '.')
+      s++;
+    else if (*c == ' ')
+    {
+      h = (h + 1) & 3;
+      s = 0;
+    }
+    else
+    {
+      const char * r = strchr(ranks, *c);
+      if (r == nullptr || s >= DDS_SUITS)
+        return false;
+      hold[DDS_SUITS * h + s] |= static_cast<unsigned short>
+        (1 << (2 + (r - ranks)));
+    }
+  }
+  return true;
+}
+
+
+void * map_temp(
+  size_t                size)
+{
+  // The file is removed at once.  The mapping stays valid, and it
+  // is shared with the workers, but nothing is left behind.
+  const char * dir = getenv("TMPDIR");
+  char fname[256];
+  snprintf(fname, sizeof(fname), "%s/ptestXXXXXX", 
+    (dir == nullptr ? "/tmp" : dir));
+
+  int fd = mkstemp(fname);
+  if (fd < 0)
+  {
+    printf("Could not create %s\n", fname);
+    return nullptr;
+  }
+  unlink(fname);
+
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    printf("Could not size %s\n", fname);
+    close(fd);
+    return nullptr;
+  }
+
+  void * p = mmap(nullptr, size, PROT_READ | PROT_WRITE, 
+    MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (p == MAP_FAILED)
+  {
+    printf("Could not map %s\n", fname);
+    return nullptr;
+  }
+  return p;
+}
+
+
+bool run_worker(
+  controlType           * ctl,
+  workerType            * wp,
+  int                   number,
+  const unsigned short  * holdings,
+  unsigned char         * tricks)
+{
+  int trumpFilter[DDS_STRAINS] = {0, 0, 0, 0, 0};
+  bool ok = true;
+  timeval t0;
+  gettimeofday(&t0, nullptr);
+
+  while (1)
+  {
+    int start = __sync_fetch_and_add(&ctl->next, MAXNOOFTABLES);
+    if (start >= number)
+      break;
+
+    int count = (start + MAXNOOFTABLES > number ?
+      number - start : MAXNOOFTABLES);
+
+    ddTableDeals dls;
+    ddTablesRes res;
+    dls.noOfTables = count;
+    const unsigned short * hp = holdings + HOLDINGS * start;
+    for (int m = 0; m < count; m++)
+      for (int h = 0; h < DDS_HANDS; h++)
+        for (int s = 0; s < DDS_SUITS; s++)
+          dls.deals[m].cards[h][s] = *hp++;
+
+    int ret = CalcAllTables(&dls, -1, trumpFilter, &res, nullptr);
+    if (ret != RETURN_NO_FAULT)
+    {
+      char line[80];
+      ErrorMessage(ret, line);
+      printf("Shard at %d: %s\n", start, line);
+      ok = false;
+    }
+    else
+    {
+      unsigned char * tp = tricks + TRICKS * start;
+      for (int m = 0; m < count; m++)
+        for (int s = 0; s < DDS_STRAINS; s++)
+          for (int h = 0; h < DDS_HANDS; h++)
+            *tp++ = static_cast<unsigned char>(
+              res.results[m].resTable[s][h]);
+    }
+
+    wp->shards++;
+    wp->deals += count;
+  }
+
+  wp->timeMs = ms_since(&t0);
+  wp->rssKB  = status_kb("/proc/self/status", "VmHWM:");
+  wp->pssKB  = status_kb("/proc/self/smaps_rollup", "Pss:");
+  return ok;
+}
+
+
+long status_kb(
+  const char            * fname,
+  const char            * key)
+{
+  // Only on Linux, otherwise reported as 0.
+#ifdef __linux__
+  FILE * fp = fopen(fname, "r");
+#else
+  FILE * fp = nullptr;
+#endif
+  if (fp == nullptr)
+    return 0;
+
+  char line[256];
+  long kb = 0;
+  size_t len = strlen(key);
+  while (fgets(line, sizeof(line), fp))
+  {
+    if (strncmp(line, key, len) == 0)
+    {
+      kb = atol(line + len);
+      break;
+    }
+  }
+  fclose(fp);
+  return kb;
+}
+
+
+int ms_since(
+  timeval               * t0)
+{
+  timeval t1;
+  gettimeofday(&t1, nullptr);
+  return static_cast<int>(1000 * (t1.tv_sec - t0->tv_sec) +
+    (t1.tv_usec - t0->tv_usec) / 1000);
+}
+
+#endif
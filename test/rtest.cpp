@@ -0,0 +1,601 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+/*
+   rtest replays a call log written by the library after
+   StartRecording().  The calls are issued either as fast as
+   possible or at the times at which they were recorded.
+
+   Consecutive single-board calls (SolveBoard, AnalysePlayBin,
+   AnalysePlayAlternativesBin and Par) are spread over the replay
+   threads, each of which uses its own thread index.  The batch calls use all of the library's
+   threads themselves, so they are issued one at a time in between.
+
+   For each type of call the latency is the time from issuing the
+   call to its return.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../include/dll.h"
+
+#define REC_TYPES 9
+
+using namespace std;
+using namespace std::chrono;
+
+
+struct callType
+{
+  int                   type;
+  long long             time;
+  size_t                offset;
+  long long             latency;
+  int                   result;
+};
+
+struct replayType
+{
+  vector<unsigned char> buf;
+  vector<callType>      calls;
+  bool                  timed;
+  steady_clock::time_point start;
+};
+
+
+const char * recNames[REC_TYPES] =
+{
+  "", "SolveBoard", "SolveAll", "CalcDDtable", "CalcAllTables",
+  "Par", "AnalysePlay", "AnalyseAllPlays", "PlayAlternatives"
+};
+
+
+int get_byte(
+  replayType            * rp,
+  size_t                * pos);
+
+void get_cards(
+  replayType            * rp,
+  size_t                * pos,
+  unsigned              cards[DDS_HANDS][DDS_SUITS]);
+
+void get_deal(
+  replayType            * rp,
+  size_t                * pos,
+  deal                  * dl);
+
+void get_trace(
+  replayType            * rp,
+  size_t                * pos,
+  playTraceBin          * play);
+
+bool read_log(
+  const char            * fname,
+  replayType            * rp);
+
+bool skip_call(
+  replayType            * rp,
+  size_t                * pos,
+  int                   type);
+
+bool single_call(
+  int                   type);
+
+void issue_call(
+  replayType            * rp,
+  callType              * cp,
+  int                   thrId);
+
+void run_single(
+  replayType            * rp,
+  size_t                first,
+  size_t                last,
+  int                   threads);
+
+void print_stats(
+  replayType            * rp,
+  long long             wallTime);
+
+
+int main(int argc, char * argv[])
+{
+  if (argc < 2 || argc > 4)
+  {
+    printf("Usage: rtest file.rec [fast|timed] [threads]\n");
+    return 1;
+  }
+
+  replayType replay;
+  replay.timed = (argc >= 3 && strcmp(argv[2], "timed") == 0);
+  int threads = (argc == 4 ? atoi(argv[3]) : 1);
+
+  if (! read_log(argv[1], &replay))
+    return 1;
+
+  SetMaxThreads(threads);
+
+  threadStats stats;
+  GetThreadStats(&stats);
+  if (threads > stats.noOfThreads)
+  {
+    printf("Using %d threads\n", stats.noOfThreads);
+    threads = stats.noOfThreads;
+  }
+  if (threads < 1)
+    threads = 1;
+
+  size_t n = replay.calls.size();
+  replay.start = steady_clock::now();
+
+  size_t i = 0;
+  while (i < n)
+  {
+    if (single_call(replay.calls[i].type))
+    {
+      size_t j = i;
+      while (j < n && single_call(replay.calls[j].type))
+        j++;
+      run_single(&replay, i, j, threads);
+      i = j;
+    }
+    else
+    {
+      issue_call(&replay, &replay.calls[i], 0);
+      i++;
+    }
+  }
+
+  long long wallTime = duration_cast<microseconds>(
+    steady_clock::now() - replay.start).count();
+
+  print_stats(&replay, wallTime);
+  FreeMemory();
+  return 0;
+}
+
+
+template <class T>
+T get(
+  replayType            * rp,
+  size_t                * pos)
+{
+  T v;
+  memcpy(&v, &rp->buf[*pos], sizeof(T));
+  *pos += sizeof(T);
+  return v;
+}
+
+
+int get_byte(
+  replayType            * rp,
+  size_t                * pos)
+{
+  return static_cast<signed char>(rp->buf[(*pos)++]);
+}
+
+
+void get_cards(
+  replayType            * rp,
+  size_t                * pos,
+  unsigned              cards[DDS_HANDS][DDS_SUITS])
+{
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      cards[h][s] = get<unsigned short>(rp, pos);
+}
+
+
+void get_deal(
+  replayType            * rp,
+  size_t                * pos,
+  deal                  * dl)
+{
+  dl->trump = get_byte(rp, pos);
+  dl->first = get_byte(rp, pos);
+  for (int k = 0; k < 3; k++)
+    dl->currentTrickSuit[k] = get_byte(rp, pos);
+  for (int k = 0; k < 3; k++)
+    dl->currentTrickRank[k] = get_byte(rp, pos);
+  get_cards(rp, pos, dl->remainCards);
+}
+
+
+void get_trace(
+  replayType            * rp,
+  size_t                * pos,
+  playTraceBin          * play)
+{
+  play->number = get_byte(rp, pos);
+  for (int k = 0; k < play->number; k++)
+  {
+    play->suit[k] = get_byte(rp, pos);
+    play->rank[k] = get_byte(rp, pos);
+  }
+}
+
+
+bool read_log(
+  const char            * fname,
+  replayType            * rp)
+{
+  FILE * fp = fopen(fname, "rb");
+  if (fp == nullptr)
+  {
+    printf("Could not open %s\n", fname);
+    return false;
+  }
+
+  unsigned char chunk[65536];
+  size_t len;
+  while ((len = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    rp->buf.insert(rp->buf.end(), chunk, chunk + len);
+  fclose(fp);
+
+  if (rp->buf.size() < 8 || memcmp(&rp->buf[0], "DDSR", 4) != 0)
+  {
+    printf("%s is not a DDS call log\n", fname);
+    return false;
+  }
+
+  size_t pos = 4;
+  int version = get<int>(rp, &pos);
+  if (version != DDS_VERSION)
+    printf("Log was written by version %d\n", version);
+
+  size_t size = rp->buf.size();
+  while (pos + 10 <= size)
+  {
+    callType call;
+    call.type    = rp->buf[pos++];
+    pos++;
+    call.time    = get<long long>(rp, &pos);
+    call.offset  = pos;
+    call.latency = 0;
+    call.result  = RETURN_NO_FAULT;
+
+    if (call.type < 1 || call.type >= REC_TYPES ||
+        ! skip_call(rp, &pos, call.type) || pos > size)
+    {
+      printf("Log is damaged after %d calls\n",
+        static_cast<int>(rp->calls.size()));
+      break;
+    }
+    rp->calls.push_back(call);
+  }
+
+  printf("%-20s  %12d\n\n", "Calls in log",
+    static_cast<int>(rp->calls.size()));
+  return true;
+}
+
+
+bool skip_call(
+  replayType            * rp,
+  size_t                * pos,
+  int                   type)
+{
+  // Only the variable-length parts need to be looked at.
+
+  const size_t dealSize  = 8 + 2 * DDS_HANDS * DDS_SUITS;
+  const size_t cardsSize = 2 * DDS_HANDS * DDS_SUITS;
+  size_t size = rp->buf.size();
+  int n;
+
+  switch (type)
+  {
+    case DDS_REC_SOLVEBOARD:
+      *pos += dealSize + 3;
+      break;
+
+    case DDS_REC_SOLVEALL:
+      if (*pos + 3 > size)
+        return false;
+      n = get<unsigned short>(rp, pos);
+      *pos += 1 + static_cast<size_t>(n) * (dealSize + 3);
+      break;
+
+    case DDS_REC_CALCDDTABLE:
+      *pos += cardsSize;
+      break;
+
+    case DDS_REC_CALCALLTABLES:
+      if (*pos + 8 > size)
+        return false;
+      n = get<unsigned short>(rp, pos);
+      *pos += 6 + static_cast<size_t>(n) * cardsSize;
+      break;
+
+    case DDS_REC_PAR:
+      *pos += DDS_STRAINS * DDS_HANDS + 1;
+      break;
+
+    case DDS_REC_ANALYSEPLAY:
+    case DDS_REC_ALTERNATIVES:
+      *pos += dealSize;
+      if (*pos >= size)
+        return false;
+      *pos += 1 + 2 * static_cast<size_t>(rp->buf[*pos]);
+      break;
+
+    case DDS_REC_ANALYSEALLPLAYS:
+      if (*pos + 3 > size)
+        return false;
+      n = get<unsigned short>(rp, pos);
+      *pos += 1;
+      for (int b = 0; b < n; b++)
+      {
+        *pos += dealSize;
+        if (*pos >= size)
+          return false;
+        *pos += 1 + 2 * static_cast<size_t>(rp->buf[*pos]);
+      }
+      break;
+
+    default:
+      return false;
+  }
+  return true;
+}
+
+
+bool single_call(
+  int                   type)
+{
+  return (type == DDS_REC_SOLVEBOARD ||
+          type == DDS_REC_ANALYSEPLAY ||
+          type == DDS_REC_ALTERNATIVES ||
+          type == DDS_REC_PAR);
+}
+
+
+void issue_call(
+  replayType            * rp,
+  callType              * cp,
+  int                   thrId)
+{
+  if (rp->timed)
+    this_thread::sleep_until(rp->start +
+      microseconds(cp->time - rp->calls[0].time));
+
+  size_t pos = cp->offset;
+  int res = RETURN_NO_FAULT;
+
+  // The inputs are decoded before the clock starts.
+
+  if (cp->type == DDS_REC_SOLVEBOARD)
+  {
+    deal dl;
+    futureTricks fut;
+    get_deal(rp, &pos, &dl);
+    int target    = get_byte(rp, &pos);
+    int solutions = get_byte(rp, &pos);
+    int mode      = get_byte(rp, &pos);
+
+    auto t0 = steady_clock::now();
+    res = SolveBoard(dl, target, solutions, mode, &fut, thrId);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+  }
+  else if (cp->type == DDS_REC_SOLVEALL)
+  {
+    boards * bop = new boards;
+    solvedBoards * solvedp = new solvedBoards;
+    bop->noOfBoards = get<unsigned short>(rp, &pos);
+    int chunkSize   = get_byte(rp, &pos);
+    for (int b = 0; b < bop->noOfBoards; b++)
+    {
+      get_deal(rp, &pos, &bop->deals[b]);
+      bop->target[b]    = get_byte(rp, &pos);
+      bop->solutions[b] = get_byte(rp, &pos);
+      bop->mode[b]      = get_byte(rp, &pos);
+    }
+
+    auto t0 = steady_clock::now();
+    res = SolveAllChunksBin(bop, solvedp, chunkSize);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+
+    delete bop;
+    delete solvedp;
+  }
+  else if (cp->type == DDS_REC_CALCDDTABLE)
+  {
+    ddTableDeal tableDeal;
+    ddTableResults table;
+    get_cards(rp, &pos, tableDeal.cards);
+
+    auto t0 = steady_clock::now();
+    res = CalcDDtable(tableDeal, &table);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+  }
+  else if (cp->type == DDS_REC_CALCALLTABLES)
+  {
+    ddTableDeals * dealsp = new ddTableDeals;
+    ddTablesRes * resp = new ddTablesRes;
+    allParResults * presp = new allParResults;
+    int trumpFilter[DDS_STRAINS];
+
+    dealsp->noOfTables = get<unsigned short>(rp, &pos);
+    int mode = get_byte(rp, &pos);
+    for (int k = 0; k < DDS_STRAINS; k++)
+      trumpFilter[k] = get_byte(rp, &pos);
+    for (int m = 0; m < dealsp->noOfTables; m++)
+      get_cards(rp, &pos, dealsp->deals[m].cards);
+
+    auto t0 = steady_clock::now();
+    res = CalcAllTables(dealsp, mode, trumpFilter, resp, presp);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+
+    delete dealsp;
+    delete resp;
+    delete presp;
+  }
+  else if (cp->type == DDS_REC_PAR)
+  {
+    ddTableResults table;
+    parResults par;
+    for (int s = 0; s < DDS_STRAINS; s++)
+      for (int h = 0; h < DDS_HANDS; h++)
+        table.resTable[s][h] = get_byte(rp, &pos);
+    int vulnerable = get_byte(rp, &pos);
+
+    auto t0 = steady_clock::now();
+    res = Par(&table, &par, vulnerable);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+  }
+  else if (cp->type == DDS_REC_ANALYSEPLAY)
+  {
+    deal dl;
+    playTraceBin play;
+    solvedPlay solved;
+    get_deal(rp, &pos, &dl);
+    get_trace(rp, &pos, &play);
+
+    auto t0 = steady_clock::now();
+    res = AnalysePlayBin(dl, play, &solved, thrId);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+  }
+  else if (cp->type == DDS_REC_ALTERNATIVES)
+  {
+    deal dl;
+    playTraceBin play;
+    playAlternatives * altp = new playAlternatives;
+    get_deal(rp, &pos, &dl);
+    get_trace(rp, &pos, &play);
+
+    auto t0 = steady_clock::now();
+    res = AnalysePlayAlternativesBin(dl, play, altp, thrId);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+
+    delete altp;
+  }
+  else if (cp->type == DDS_REC_ANALYSEALLPLAYS)
+  {
+    boards * bop = new boards;
+    playTracesBin * plp = new playTracesBin;
+    solvedPlays * solvedp = new solvedPlays;
+
+    bop->noOfBoards = get<unsigned short>(rp, &pos);
+    plp->noOfBoards = bop->noOfBoards;
+    int chunkSize   = get_byte(rp, &pos);
+    for (int b = 0; b < bop->noOfBoards; b++)
+    {
+      get_deal(rp, &pos, &bop->deals[b]);
+      get_trace(rp, &pos, &plp->plays[b]);
+    }
+
+    auto t0 = steady_clock::now();
+    res = AnalyseAllPlaysBin(bop, plp, solvedp, chunkSize);
+    cp->latency = duration_cast<microseconds>(
+      steady_clock::now() - t0).count();
+
+    delete bop;
+    delete plp;
+    delete solvedp;
+  }
+
+  cp->result = res;
+}
+
+
+void run_single(
+  replayType            * rp,
+  size_t                first,
+  size_t                last,
+  int                   threads)
+{
+  if (threads == 1 || last - first == 1)
+  {
+    for (size_t i = first; i < last; i++)
+      issue_call(rp, &rp->calls[i], 0);
+    return;
+  }
+
+  atomic<size_t> next(first);
+  vector<thread> pool;
+
+  for (int t = 0; t < threads; t++)
+  {
+    pool.push_back(thread([rp, last, t, &next]()
+    {
+      size_t i;
+      while ((i = next++) < last)
+        issue_call(rp, &rp->calls[i], t);
+    }));
+  }
+
+  for (auto& th : pool)
+    th.join();
+}
+
+
+void print_stats(
+  replayType            * rp,
+  long long             wallTime)
+{
+  vector<long long> lat[REC_TYPES];
+  int errors[REC_TYPES] = {0};
+
+  for (auto& call : rp->calls)
+  {
+    lat[call.type].push_back(call.latency);
+    if (call.result != RETURN_NO_FAULT)
+      errors[call.type]++;
+  }
+
+  printf("%-16s %7s %6s %10s %10s %10s %10s %10s\n",
+    "Call", "Number", "Errors", "Mean (us)", "p50", "p90", "p99", "Max");
+
+  for (int t = 1; t < REC_TYPES; t++)
+  {
+    vector<long long>& v = lat[t];
+    if (v.empty())
+      continue;
+
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    long long sum = 0;
+    for (long long l : v)
+      sum += l;
+
+    printf("%-16s %7d %6d %10lld %10lld %10lld %10lld %10lld\n",
+      recNames[t],
+      static_cast<int>(n),
+      errors[t],
+      sum / static_cast<long long>(n),
+      v[n / 2],
+      v[(n * 9) / 10],
+      v[(n * 99) / 100],
+      v[n - 1]);
+  }
+
+  size_t n = rp->calls.size();
+  printf("\n%-20s  %12lld\n", "Wall time (ms)", wallTime / 1000);
+  if (wallTime > 0)
+    printf("%-20s  %12.1f\n", "Calls per second",
+      1.e6 * static_cast<double>(n) / static_cast<double>(wallTime));
+  if (n > 0)
+    printf("%-20s  %12lld\n\n", "Recorded span (ms)",
+      (rp->calls[n - 1].time - rp->calls[0].time) / 1000);
+}
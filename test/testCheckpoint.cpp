@@ -0,0 +1,328 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/dll.h"
+#include "testCheckpoint.h"
+
+#define CK_MAGIC        0x4b434444 // "DDCK"
+
+// The record header is followed by size bytes of result.
+
+struct ckHeaderType
+{
+  unsigned              magic;
+  int                   type;
+  unsigned long long    key;
+  unsigned              size;
+  unsigned              checksum;
+};
+
+struct ckEntryType
+{
+  unsigned long long    key;
+  int                   index;
+};
+
+FILE                    * ckFile = nullptr;
+int                     ckType;
+unsigned                ckSize;
+
+// The results that were found in the file when it was opened.
+ckEntryType             * ckEntries = nullptr;
+char                    * ckResults = nullptr;
+int                     ckCount = 0;
+
+
+unsigned CheckpointSum(
+  unsigned long long    key,
+  const void            * result,
+  unsigned              size);
+
+int CheckpointLoad(
+  const char            * fname);
+
+bool CheckpointRewrite(
+  const char            * fname);
+
+int CheckpointCompare(
+  const void            * a,
+  const void            * b);
+
+
+unsigned CheckpointSum(
+  unsigned long long    key,
+  const void            * result,
+  unsigned              size)
+{
+  // FNV-1a over the key and the result.
+  unsigned sum = 2166136261u;
+
+  for (int i = 0; i < 8; i++)
+  {
+    sum ^= static_cast<unsigned>((key >> (8*i)) & 0xff);
+    sum *= 16777619u;
+  }
+
+  const unsigned char * p = static_cast<const unsigned char *>(result);
+  for (unsigned i = 0; i < size; i++)
+  {
+    sum ^= p[i];
+    sum *= 16777619u;
+  }
+  return sum;
+}
+
+
+unsigned long long CheckpointKey(
+  const dealPBN         * dl,
+  const char            * extra)
+{
+  // FNV-1a over what makes the input different.
+  unsigned long long key = 14695981039346656037ULL;
+
+  const int head[2] = { dl->trump, dl->first };
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(head);
+  for (unsigned i = 0; i < sizeof(head); i++)
+  {
+    key ^= p[i];
+    key *= 1099511628211ULL;
+  }
+
+  for (const char * s = dl->remainCards; *s; s++)
+  {
+    key ^= static_cast<unsigned char>(*s);
+    key *= 1099511628211ULL;
+  }
+
+  for (const char * s = extra; s && *s; s++)
+  {
+    key ^= static_cast<unsigned char>(*s);
+    key *= 1099511628211ULL;
+  }
+  return key;
+}
+
+
+int CheckpointCompare(
+  const void            * a,
+  const void            * b)
+{
+  unsigned long long ka = static_cast<const ckEntryType *>(a)->key;
+  unsigned long long kb = static_cast<const ckEntryType *>(b)->key;
+  return (ka < kb ? -1 : (ka > kb ? 1 : 0));
+}
+
+
+int CheckpointLoad(
+  const char            * fname)
+{
+  // Returns 0 if the file is fine or does not exist yet, 1 if it
+  // has a damaged tail, which is then cut off by rewriting the
+  // file, and -1 if it is from another kind of run.
+
+  FILE * fp = fopen(fname, "rb");
+  if (fp == nullptr)
+    return 0;
+
+  int capacity = 0;
+  bool clean = true;
+  ckHeaderType hd;
+  char * result = static_cast<char *>(malloc(ckSize));
+
+  while (fread(&hd, sizeof(hd), 1, fp) == 1)
+  {
+    if (ckCount == 0 && hd.magic == CK_MAGIC &&
+        (hd.type != ckType || hd.size != ckSize))
+    {
+      free(result);
+      fclose(fp);
+      return -1;
+    }
+
+    if (hd.magic != CK_MAGIC || hd.type != ckType || hd.size != ckSize ||
+        fread(result, ckSize, 1, fp) != 1 ||
+        hd.checksum != CheckpointSum(hd.key, result, ckSize))
+    {
+      clean = false;
+      break;
+    }
+
+    if (ckCount == capacity)
+    {
+      capacity = (capacity == 0 ? 1024 : 2 * capacity);
+      ckEntries = static_cast<ckEntryType *>(realloc(ckEntries,
+        static_cast<size_t>(capacity) * sizeof(ckEntryType)));
+      ckResults = static_cast<char *>(realloc(ckResults,
+        static_cast<size_t>(capacity) * ckSize));
+    }
+
+    ckEntries[ckCount].key   = hd.key;
+    ckEntries[ckCount].index = ckCount;
+    memcpy(ckResults + static_cast<size_t>(ckCount) * ckSize,
+      result, ckSize);
+    ckCount++;
+  }
+
+  // A partial header at the end is also a damaged tail.
+  if (clean && ! feof(fp))
+    clean = false;
+  else if (clean && ftell(fp) != static_cast<long>(
+      static_cast<size_t>(ckCount) * (sizeof(hd) + ckSize)))
+    clean = false;
+
+  free(result);
+  fclose(fp);
+
+  qsort(ckEntries, static_cast<size_t>(ckCount),
+    sizeof(ckEntryType), CheckpointCompare);
+  return (clean ? 0 : 1);
+}
+
+
+bool CheckpointRewrite(
+  const char            * fname)
+{
+  // The good records go to a new file first, so that the old one
+  // is still there if we are stopped in the middle of this.
+
+  char tmpname[1024];
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", fname);
+
+  FILE * fp = fopen(tmpname, "wb");
+  if (fp == nullptr)
+    return false;
+
+  // In file order, which does not matter, but is tidy.
+  int * order = static_cast<int *>(malloc(
+    static_cast<size_t>(ckCount + 1) * sizeof(int)));
+  for (int i = 0; i < ckCount; i++)
+    order[ ckEntries[i].index ] = i;
+
+  ckHeaderType hd;
+  hd.magic = CK_MAGIC;
+  hd.type  = ckType;
+  hd.size  = ckSize;
+
+  for (int n = 0; n < ckCount; n++)
+  {
+    const char * result = ckResults + static_cast<size_t>(n) * ckSize;
+    hd.key      = ckEntries[ order[n] ].key;
+    hd.checksum = CheckpointSum(hd.key, result, ckSize);
+    fwrite(&hd, sizeof(hd), 1, fp);
+    fwrite(result, ckSize, 1, fp);
+  }
+
+  free(order);
+
+  if (fclose(fp) != 0)
+    return false;
+
+  remove(fname);
+  return (rename(tmpname, fname) == 0);
+}
+
+
+bool CheckpointOpen(
+  const char            * fname,
+  int                   type,
+  unsigned              size)
+{
+  ckType = type;
+  ckSize = size;
+
+  int status = CheckpointLoad(fname);
+  if (status == -1)
+  {
+    printf("Checkpoint %s: not from this kind of run\n", fname);
+    return false;
+  }
+  else if (status == 1)
+  {
+    printf("Checkpoint %s: damaged end cut off\n", fname);
+    if (! CheckpointRewrite(fname))
+      return false;
+  }
+
+  ckFile = fopen(fname, "ab");
+  return (ckFile != nullptr);
+}
+
+
+void CheckpointClose()
+{
+  if (ckFile != nullptr)
+    fclose(ckFile);
+  ckFile = nullptr;
+
+  free(ckEntries);
+  free(ckResults);
+  ckEntries = nullptr;
+  ckResults = nullptr;
+  ckCount = 0;
+}
+
+
+bool CheckpointFind(
+  unsigned long long    key,
+  void                  * result)
+{
+  if (ckCount == 0)
+    return false;
+
+  ckEntryType sought;
+  sought.key = key;
+
+  ckEntryType * ep = static_cast<ckEntryType *>(bsearch(&sought,
+    ckEntries, static_cast<size_t>(ckCount), sizeof(ckEntryType),
+    CheckpointCompare));
+  if (ep == nullptr)
+    return false;
+
+  memcpy(result, ckResults + static_cast<size_t>(ep->index) * ckSize,
+    ckSize);
+  return true;
+}
+
+
+void CheckpointAdd(
+  unsigned long long    key,
+  const void            * result)
+{
+  if (ckFile == nullptr)
+    return;
+
+  ckHeaderType hd;
+  hd.magic    = CK_MAGIC;
+  hd.type     = ckType;
+  hd.key      = key;
+  hd.size     = ckSize;
+  hd.checksum = CheckpointSum(key, result, ckSize);
+
+  fwrite(&hd, sizeof(hd), 1, ckFile);
+  fwrite(result, ckSize, 1, ckFile);
+}
+
+
+void CheckpointFlush()
+{
+  // Once per batch, so that a stopped run loses at most a batch.
+  if (ckFile != nullptr)
+    fflush(ckFile);
+}
+
+
+int CheckpointCount()
+{
+  return ckCount;
+}
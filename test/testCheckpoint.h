@@ -0,0 +1,50 @@
+/*
+   DDS, a bridge double dummy solver.
+
+   Copyright (C) 2006-2014 by Bo Haglund /
+   2014 by Bo Haglund & Soren Hein.
+
+   See LICENSE and README.
+*/
+
+
+#ifndef DDS_CHECKPOINTH
+#define DDS_CHECKPOINTH
+
+/*
+   A checkpoint file keeps the results of a long dtest run as they
+   are solved, so that a run that is stopped can be started again
+   with the same file and only solves the rest.  Each result is a
+   record with the fingerprint of its input and a checksum, so a
+   record that was cut off when the run stopped is simply dropped.
+   Without an open file, the functions do nothing.
+*/
+
+#define CHECKPOINT_SOLVE        1
+#define CHECKPOINT_CALC         2
+#define CHECKPOINT_PLAY         3
+
+bool CheckpointOpen(
+  const char                    * fname,
+  int                           type,
+  unsigned                      size);
+
+void CheckpointClose();
+
+unsigned long long CheckpointKey(
+  const struct dealPBN          * dl,
+  const char                    * extra);
+
+bool CheckpointFind(
+  unsigned long long            key,
+  void                          * result);
+
+void CheckpointAdd(
+  unsigned long long            key,
+  const void                    * result);
+
+void CheckpointFlush();
+
+int CheckpointCount();
+
+#endif
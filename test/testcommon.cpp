@@ -15,6 +15,7 @@
 #include "../include/dll.h"
 #include "../include/portab.h"
 #include "testStats.h"
+#include "testCheckpoint.h"
 
 
 #ifdef _WIN32
@@ -49,6 +50,21 @@ clock_t ts0, ts1;
 int     tu , ts, ctu, cts;
 
 
+#define SCALE_RUNS 8
+
+struct scaleType
+{
+  int                   threads;
+  int                   userTime;
+  int                   systTime;
+  threadStats           stats;
+};
+
+scaleType scale_list[SCALE_RUNS];
+int scale_number = 0;
+int scale_limit = 0;
+
+
 int realMain(int argc, char * argv[]);
 
 int realMain(int argc, char * argv[])
@@ -59,10 +75,27 @@ int realMain(int argc, char * argv[])
 
   TestSetTimerName("Timer title");
 
-  if (argc != 3 && argc != 4)
+  int maxThreads = 0;
+  char * ckname = nullptr;
+  if (argc == 4 || argc == 5)
+  {
+    if (! strcmp(argv[3], "scale"))
+      maxThreads = (argc == 5 ? atoi(argv[4]) : MAXNOOFTHREADS);
+    else if (argc == 5 && ! strcmp(argv[3], "checkpoint"))
+      ckname = argv[4];
+    else if (argc == 5)
+      maxThreads = -1;
+  }
+
+  if (argc < 3 || argc > 5 || maxThreads < 0 || 
+      maxThreads > MAXNOOFTHREADS)
   {
     printf(
-      "Usage: dtest file.txt solve|calc|par|dealerpar|play [ncores]\n");
+      "Usage: dtest file.txt solve|calc|par|dealerpar|play [ncores]\n"
+      "       dtest file.txt solve|calc|par|dealerpar|play "
+      "scale [maxthreads]\n"
+      "       dtest file.txt calcdealerpar\n"
+      "       dtest file.txt solve|calc|play checkpoint file.ck\n");
     return 1;
   }
 
@@ -77,6 +110,8 @@ int realMain(int argc, char * argv[])
     input_number = PAR_REPEAT;
   else if (! strcmp(type, "dealerpar"))
     input_number = PAR_REPEAT;
+  else if (! strcmp(type, "calcdealerpar"))
+    input_number = PAR_REPEAT;
   else if (! strcmp(type, "play"))
     input_number = TRACE_SIZE;
 
@@ -113,60 +148,123 @@ int realMain(int argc, char * argv[])
     exit(0);
   }
 
-  if (! strcmp(type, "solve"))
+  // With a checkpoint file, the results that are already in it
+  // are not solved again.
+  if (ckname)
   {
-    if (GIBmode)
+    int cktype = 0;
+    unsigned cksize = 0;
+    if (! strcmp(type, "solve"))
     {
-      printf("GIB file does not work with solve\n");
-      exit(0);
+      cktype = CHECKPOINT_SOLVE;
+      cksize = sizeof(futureTricks);
     }
-    loop_solve(&bop, &solvedbdp, deal_list, fut_list, number);
-  }
-  else if (! strcmp(type, "calc"))
-  {
-    loop_calc(&dealsp, &resp, &parp, 
-      deal_list, table_list, number);
-  }
-  else if (! strcmp(type, "par"))
-  {
-    if (GIBmode)
+    else if (! strcmp(type, "calc"))
     {
-      printf("GIB file does not work with solve\n");
-      exit(0);
+      cktype = CHECKPOINT_CALC;
+      cksize = sizeof(ddTableResults);
     }
-    loop_par(vul_list, table_list, par_list, number);
-  }
-  else if (! strcmp(type, "dealerpar"))
-  {
-    if (GIBmode)
+    else if (! strcmp(type, "play"))
     {
-      printf("GIB file does not work with solve\n");
+      cktype = CHECKPOINT_PLAY;
+      cksize = sizeof(solvedPlay);
+    }
+
+    if (cktype == 0 || ! CheckpointOpen(ckname, cktype, cksize))
+    {
+      printf("Cannot use checkpoint file %s with %s\n", ckname, type);
       exit(0);
     }
-    loop_dealerpar(dealer_list, vul_list, table_list, 
-      dealerpar_list, number);
+    printf("Checkpoint %s: %d results\n\n", ckname, CheckpointCount());
   }
-  else if (! strcmp(type, "play"))
+
+  // In scaling mode the same input is run once for each number
+  // of threads, 1, 2, 4, ... up to maxThreads.
+  int threads = 1;
+  while (1)
   {
-    if (GIBmode)
+    if (maxThreads)
+      scale_start(threads);
+
+    if (! strcmp(type, "solve"))
+    {
+      if (GIBmode)
+      {
+        printf("GIB file does not work with solve\n");
+        exit(0);
+      }
+      loop_solve(&bop, &solvedbdp, deal_list, fut_list, number);
+    }
+    else if (! strcmp(type, "calc"))
+    {
+      loop_calc(&dealsp, &resp, &parp, 
+        deal_list, table_list, number);
+    }
+    else if (! strcmp(type, "par"))
+    {
+      if (GIBmode)
+      {
+        printf("GIB file does not work with solve\n");
+        exit(0);
+      }
+      loop_par(vul_list, table_list, par_list, number);
+    }
+    else if (! strcmp(type, "dealerpar"))
+    {
+      if (GIBmode)
+      {
+        printf("GIB file does not work with solve\n");
+        exit(0);
+      }
+      loop_dealerpar(dealer_list, vul_list, table_list, 
+        dealerpar_list, number);
+    }
+    else if (! strcmp(type, "calcdealerpar"))
+    {
+      if (GIBmode)
+      {
+        printf("GIB file does not work with calcdealerpar\n");
+        exit(0);
+      }
+      loop_calcdealerpar(dealer_list, vul_list, deal_list,
+        dealerpar_list, number);
+    }
+    else if (! strcmp(type, "play"))
+    {
+      if (GIBmode)
+      {
+        printf("GIB file does not work with solve\n");
+        exit(0);
+      }
+      loop_play(&bop, &playsp, &solvedplp, 
+        deal_list, play_list, trace_list, number);
+    }
+    else 
     {
-      printf("GIB file does not work with solve\n");
+      printf("Unknown type %s\n", type);
       exit(0);
     }
-    loop_play(&bop, &playsp, &solvedplp, 
-      deal_list, play_list, trace_list, number);
-  }
-  else 
-  {
-    printf("Unknown type %s\n", type);
-    exit(0);
+
+    if (! maxThreads)
+      break;
+
+    if (! scale_end(threads) || threads >= maxThreads)
+      break;
+
+    threads = (2 * threads > maxThreads ? maxThreads : 2 * threads);
   }
 
-  print_times(number);
+  if (maxThreads)
+    scale_print(fname, type, number);
+  else
+    print_times(number);
+
   TestPrintTimer();
   TestPrintTimerList();
   TestPrintCounter();
 
+  CheckpointClose();
+
   free(dealer_list);
   free(vul_list);
   free(deal_list);
@@ -981,24 +1079,49 @@ void loop_solve(
   {
     int count = (i + input_number > number ? number-i : input_number);
 
-    bop->noOfBoards = count;
+    // Only the hands that are not in the checkpoint are solved.
+    int solveNo = 0;
     for (int j = 0; j < count; j++)
     {
-      bop->deals[j]     = deal_list[i+j];
-      bop->target[j]    = -1;
-      bop->solutions[j] = 3;
-      bop->mode[j]      = 1;
+      if (CheckpointFind(CheckpointKey(&deal_list[i+j], nullptr),
+          &solvedbdp->solvedBoard[j]))
+        continue;
+
+      bop->deals[solveNo]     = deal_list[i+j];
+      bop->target[solveNo]    = -1;
+      bop->solutions[solveNo] = 3;
+      bop->mode[solveNo]      = 1;
+      solveNo++;
     }
+    bop->noOfBoards = solveNo;
 
-    timer_start();
-    int ret;
-    if ((ret = SolveAllChunks(bop, solvedbdp, 1))
-      != RETURN_NO_FAULT)
+    tu = 0;
+    if (solveNo > 0)
     {
-      printf("loop_solve i %i: Return %d\n", i, ret);
-      exit(0);
+      timer_start();
+      int ret;
+      if ((ret = SolveAllChunks(bop, solvedbdp, 1))
+        != RETURN_NO_FAULT)
+      {
+        printf("loop_solve i %i: Return %d\n", i, ret);
+        exit(0);
+      }
+      tu = timer_end();
+    }
+
+    // Spread the solved hands out again, from the back so that
+    // they do not overwrite each other.  The others are fetched
+    // again, as the solver clears all of its output.
+    for (int j = count-1; j >= 0; j--)
+    {
+      unsigned long long key = CheckpointKey(&deal_list[i+j], nullptr);
+      if (CheckpointFind(key, &solvedbdp->solvedBoard[j]))
+        continue;
+
+      solvedbdp->solvedBoard[j] = solvedbdp->solvedBoard[--solveNo];
+      CheckpointAdd(key, &solvedbdp->solvedBoard[j]);
     }
-    tu = timer_end();
+    CheckpointFlush();
 
 #ifdef BATCHTIMES
     printf("%8d  (%5.1f%%) %15d\n", 
@@ -1041,21 +1164,43 @@ bool loop_calc(
   for (int i = 0; i < number; i += input_number)
   {
     int count = (i + input_number > number ? number-i : input_number);
-    dealsp->noOfTables = count;
+
+    int solveNo = 0;
     for (int j = 0; j < count; j++)
     {
-      strcpy(dealsp->deals[j].cards, deal_list[i+j].remainCards);
+      if (CheckpointFind(CheckpointKey(&deal_list[i+j], nullptr),
+          &resp->results[j]))
+        continue;
+
+      strcpy(dealsp->deals[solveNo].cards, deal_list[i+j].remainCards);
+      solveNo++;
     }
+    dealsp->noOfTables = solveNo;
 
-    timer_start();
-    int ret;
-    if ((ret = CalcAllTablesPBN(dealsp, -1, filter, resp, parp))
-      != RETURN_NO_FAULT)
+    tu = 0;
+    if (solveNo > 0)
     {
-      printf("loop_solve i %i: Return %d\n", i, ret);
-      exit(0);
+      timer_start();
+      int ret;
+      if ((ret = CalcAllTablesPBN(dealsp, -1, filter, resp, parp))
+        != RETURN_NO_FAULT)
+      {
+        printf("loop_solve i %i: Return %d\n", i, ret);
+        exit(0);
+      }
+      tu = timer_end();
+    }
+
+    for (int j = count-1; j >= 0; j--)
+    {
+      unsigned long long key = CheckpointKey(&deal_list[i+j], nullptr);
+      if (CheckpointFind(key, &resp->results[j]))
+        continue;
+
+      resp->results[j] = resp->results[--solveNo];
+      CheckpointAdd(key, &resp->results[j]);
     }
-    tu = timer_end();
+    CheckpointFlush();
 
 #ifdef BATCHTIMES
     printf("%8d  (%5.1f%%) %15d\n", 
@@ -1153,6 +1298,49 @@ bool loop_dealerpar(
 }
 
 
+bool loop_calcdealerpar(
+  int                   * dealer_list,
+  int                   * vul_list,
+  dealPBN               * deal_list,
+  parResultsDealer      * dealerpar_list,
+  int                   number)
+{
+  /* CalcDealerPar solves what it needs of the table itself, so
+     this checks the same reference results as loop_dealerpar, but
+     from the deals. */
+
+  ddTableDeal tableDeal;
+  parResultsDealer presp;
+
+  for (int i = 0; i < number; i++)
+  {
+    if (! pbn_to_cards(deal_list[i].remainCards, tableDeal.cards))
+    {
+      printf("loop_calcdealerpar i %d: Bad PBN deal\n", i);
+      exit(0);
+    }
+
+    timer_start();
+    int ret;
+    if ((ret = CalcDealerPar(tableDeal, &presp,
+                    dealer_list[i], vul_list[i], 0))
+      != RETURN_NO_FAULT)
+    {
+      printf("loop_calcdealerpar i %i: Return %d\n", i, ret);
+      exit(0);
+    }
+    timer_end();
+
+    if (! compare_DEALERPAR(&presp, &dealerpar_list[i]))
+    {
+      printf("loop_calcdealerpar i %d: Difference\n", i);
+    }
+  }
+
+  return true;
+}
+
+
 bool loop_play(
   boardsPBN             * bop,
   playTracesPBN         * playsp,
@@ -1170,28 +1358,49 @@ bool loop_play(
   {
     int count = (i+input_number > number ? number-i : input_number);
 
-    bop->noOfBoards = count;
-    playsp->noOfBoards = count;
-
+    int solveNo = 0;
     for (int j = 0; j < count; j++)
     {
-      bop->deals[j]     = deal_list[i+j];
-      bop->target[j]    = 0;
-      bop->solutions[j] = 3;
-      bop->mode[j]      = 1;
+      if (CheckpointFind(CheckpointKey(&deal_list[i+j],
+          play_list[i+j].cards), &solvedplp->solved[j]))
+        continue;
+
+      bop->deals[solveNo]     = deal_list[i+j];
+      bop->target[solveNo]    = 0;
+      bop->solutions[solveNo] = 3;
+      bop->mode[solveNo]      = 1;
 
-      playsp->plays[j]  = play_list[i+j];
+      playsp->plays[solveNo]  = play_list[i+j];
+      solveNo++;
     }
+    bop->noOfBoards = solveNo;
+    playsp->noOfBoards = solveNo;
 
-    timer_start();
-    int ret;
-    if ((ret = AnalyseAllPlaysPBN(bop, playsp, solvedplp, 1))
-      != RETURN_NO_FAULT)
+    tu = 0;
+    if (solveNo > 0)
     {
-      printf("loop_play i %i: Return %d\n", i, ret);
-      exit(0);
+      timer_start();
+      int ret;
+      if ((ret = AnalyseAllPlaysPBN(bop, playsp, solvedplp, 1))
+        != RETURN_NO_FAULT)
+      {
+        printf("loop_play i %i: Return %d\n", i, ret);
+        exit(0);
+      }
+      tu = timer_end();
+    }
+
+    for (int j = count-1; j >= 0; j--)
+    {
+      unsigned long long key = CheckpointKey(&deal_list[i+j],
+        play_list[i+j].cards);
+      if (CheckpointFind(key, &solvedplp->solved[j]))
+        continue;
+
+      solvedplp->solved[j] = solvedplp->solved[--solveNo];
+      CheckpointAdd(key, &solvedplp->solved[j]);
     }
-    tu = timer_end();
+    CheckpointFlush();
 
 #ifdef BATCHTIMES
     printf("%8d  (%5.1f%%) %15d\n", 
@@ -1250,6 +1459,159 @@ void print_times(int number)
 }
 
 
+void scale_start(int threads)
+{
+  SetMaxThreads(threads);
+  ResetThreadStats();
+  ctu = 0;
+  cts = 0;
+}
+
+
+bool scale_end(int threads)
+{
+  // SetMaxThreads() may give us fewer threads than we asked for,
+  // in which case the run is a repeat of the previous one.
+
+  scaleType * sp = &scale_list[scale_number];
+  GetThreadStats(&sp->stats);
+
+  if (sp->stats.noOfThreads < threads || scale_number == SCALE_RUNS)
+  {
+    scale_limit = sp->stats.noOfThreads;
+    return false;
+  }
+
+  sp->threads  = threads;
+  sp->userTime = ctu;
+  sp->systTime = cts;
+  scale_number++;
+  return true;
+}
+
+
+double scale_idle(int userTime, threadStat * tp)
+{
+  // The batch times are only kept in whole milliseconds.
+  double idle = userTime - (tp->busyTime + tp->waitTime) / 1000.;
+  return (idle < 0. ? 0. : idle);
+}
+
+
+void scale_print(char * fname, char * type, int number)
+{
+  if (scale_number == 0)
+    return;
+
+  double base = scale_list[0].userTime;
+
+  printf("Scaling for %s, %s, %d hands\n\n", fname, type, number);
+  printf("%8s  %10s  %10s  %10s  %10s\n", 
+    "Threads", "Time (ms)", "CPU (ms)", "Speed-up", "Efficiency");
+
+  for (int r = 0; r < scale_number; r++)
+  {
+    scaleType * sp = &scale_list[r];
+    double speedup = (sp->userTime == 0 ? 0. : base / sp->userTime);
+    printf("%8d  %10d  %10d  %10.2f  %9.1f%%\n",
+      sp->threads, sp->userTime, sp->systTime, 
+      speedup, 100. * speedup / sp->threads);
+  }
+
+  if (scale_limit)
+    printf("Limited to %d threads by the system\n", scale_limit);
+  printf("\n");
+
+  // Idle time is what is left of the batch times when the thread
+  // was neither solving nor waiting for a board in the scheduler.
+
+  // Deals counts the deal tables that the thread set up itself
+  // and those that it took from another thread on the same cards.
+
+  printf("%8s  %6s  %6s  %10s  %10s  %10s  %6s  %6s  %8s"
+    "  %6s  %6s  %10s\n", 
+    "Threads", "Thread", "Boards", "Busy (ms)", "Idle (ms)", 
+    "Wait (ms)", "Resets", "Full", "Harvests",
+    "Built", "Shared", "Setup (ms)");
+
+  for (int r = 0; r < scale_number; r++)
+  {
+    scaleType * sp = &scale_list[r];
+    for (int t = 0; t < sp->threads; t++)
+    {
+      threadStat * tp = &sp->stats.thread[t];
+      double idle = scale_idle(sp->userTime, tp);
+      printf("%8d  %6d  %6d  %10.1f  %10.1f  %10.2f  %6d  %6d  %8d"
+        "  %6d  %6d  %10.2f\n",
+        sp->threads, t, tp->boards, 
+        tp->busyTime / 1000.,
+        idle,
+        tp->waitTime / 1000.,
+        tp->ttResets, tp->ttFullResets, tp->ttHarvests,
+        tp->dealsBuilt, tp->dealsShared, tp->setupTime / 1000.);
+    }
+  }
+  printf("\n");
+
+  char jname[80];
+  sprintf(jname, "%s_scale.json", type);
+  FILE * fp = fopen(jname, "w");
+  if (fp == nullptr)
+  {
+    printf("Could not write %s\n", jname);
+    return;
+  }
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"file\": \"%s\",\n", fname);
+  fprintf(fp, "  \"type\": \"%s\",\n", type);
+  fprintf(fp, "  \"hands\": %d,\n", number);
+  fprintf(fp, "  \"limit\": %d,\n", scale_limit);
+  fprintf(fp, "  \"runs\": [\n");
+
+  for (int r = 0; r < scale_number; r++)
+  {
+    scaleType * sp = &scale_list[r];
+    double speedup = (sp->userTime == 0 ? 0. : base / sp->userTime);
+
+    fprintf(fp, "    {\n");
+    fprintf(fp, "      \"threads\": %d,\n", sp->threads);
+    fprintf(fp, "      \"time_ms\": %d,\n", sp->userTime);
+    fprintf(fp, "      \"cpu_ms\": %d,\n", sp->systTime);
+    fprintf(fp, "      \"speedup\": %.3f,\n", speedup);
+    fprintf(fp, "      \"efficiency\": %.3f,\n", speedup / sp->threads);
+    fprintf(fp, "      \"thread\": [\n");
+
+    for (int t = 0; t < sp->threads; t++)
+    {
+      threadStat * tp = &sp->stats.thread[t];
+      double idle = scale_idle(sp->userTime, tp);
+      fprintf(fp, "        { \"boards\": %d, \"busy_ms\": %.3f, "
+        "\"idle_ms\": %.3f, \"wait_ms\": %.3f, "
+        "\"tt_resets\": %d, \"tt_full_resets\": %d, "
+        "\"tt_harvests\": %d, \"deals_built\": %d, "
+        "\"deals_shared\": %d, \"setup_ms\": %.3f }%s\n",
+        tp->boards, 
+        tp->busyTime / 1000.,
+        idle,
+        tp->waitTime / 1000.,
+        tp->ttResets, tp->ttFullResets, tp->ttHarvests,
+        tp->dealsBuilt, tp->dealsShared, tp->setupTime / 1000.,
+        (t == sp->threads - 1 ? "" : ","));
+    }
+
+    fprintf(fp, "      ]\n");
+    fprintf(fp, "    }%s\n", (r == scale_number - 1 ? "" : ","));
+  }
+
+  fprintf(fp, "  ]\n");
+  fprintf(fp, "}\n");
+  fclose(fp);
+
+  printf("Scaling results written to %s\n\n", jname);
+}
+
+
 #ifndef _WIN32
 int timeval_diff(timeval x, timeval y)
 {
@@ -1296,6 +1658,45 @@ int timer_end()
 }
 
 
+bool pbn_to_cards(
+  char                  * pbn,
+  unsigned              cards[DDS_HANDS][DDS_SUITS])
+{
+  const char * hands = "NESW";
+  const char * ranks = "23456789TJQKA";
+
+  const char * p = strchr(hands, pbn[0]);
+  if (p == nullptr || pbn[1] != ':')
+    return false;
+
+  int h = static_cast<int>(p - hands);
+  int s = 0;
+
+  for (int hh = 0; hh < DDS_HANDS; hh++)
+    for (int ss = 0; ss < DDS_SUITS; ss++)
+      cards[hh][ss] = 0;
+
+  for (char * c = pbn + 2; *c; c++)
+  {
+    if (*c == '.')
+      s++;
+    else if (*c == ' ')
+    {
+      h = (h + 1) & 3;
+      s = 0;
+    }
+    else
+    {
+      const char * r = strchr(ranks, *c);
+      if (r == nullptr || s >= DDS_SUITS)
+        return false;
+      cards[h][s] |= (1u << (2 + (r - ranks)));
+    }
+  }
+  return true;
+}
+
+
 bool consume_int(
   char                  * line,
   int                   * pos,
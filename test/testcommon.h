@@ -10,3 +10,16 @@
 
 int realMain(int argc, char * argv[]);
 
+bool read_file(
+  char                          * fname, 
+  int                           * number,
+  int                           ** dealer_list,
+  int                           ** vul_list,
+  struct dealPBN                ** deal_list,
+  struct futureTricks           ** fut_list,
+  struct ddTableResults         ** table_list,
+  struct parResults             ** par_list,
+  struct parResultsDealer       ** dealerpar_list,
+  struct playTracePBN           ** play_list,
+  struct solvedPlay             ** trace_list);
+